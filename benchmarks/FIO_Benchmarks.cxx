@@ -0,0 +1,754 @@
+/*------------------------------------------------------------------------------
+  Benchmarks for the FileIO hot paths.
+
+  Synthetic data is generated into a scratch directory, every benchmark is
+  timed until it has both a minimum number of samples and a minimum run time,
+  and the results are written as JSON. A previous run can be passed in as a
+  baseline, in which case the exit status reports regressions of the median
+  beyond a threshold, and benchmarks of the baseline missing from the run.
+
+  Usage: bench [--out file] [--baseline file] [--threshold percent]
+               [--scale n] [--min-time ms] [--filter text] [--data dir]
+------------------------------------------------------------------------------*/
+
+#include "FIO.hxx"
+#include "SyntaxHandler.hxx"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined WIN32 || defined _WIN32 || defined __WIN32 && ! defined __CYGWIN__
+
+  #ifndef WINDOWS
+    #define WINDOWS
+  #endif
+
+  #ifndef NOMINMAX
+    #define NOMINMAX
+  #endif
+
+#endif
+
+#ifdef WINDOWS
+  #include <filesystem>
+namespace fs = std::filesystem;
+#else
+  #include <experimental/filesystem>
+namespace fs = std::experimental::filesystem;
+#endif
+
+namespace FIOBenchmarks
+{
+  using namespace FileIO;
+  using namespace hst;
+
+  struct BenchmarkOptions
+  {
+    std::string outputPath;
+    std::string baselinePath;
+    std::string filter;
+    std::string dataDir;
+    double threshold = 10.0;
+    std::size_t scale = 1;
+    std::chrono::milliseconds minTime{ 200 };
+    std::size_t minSamples = 10;
+    std::size_t maxSamples = 1000;
+  };
+
+  struct BenchmarkResult
+  {
+    std::string name;
+    std::size_t samples = 0;
+    // Work done by one timed operation, used for the throughput figures.
+    std::size_t bytesPerOp = 0;
+    std::size_t itemsPerOp = 0;
+    double meanNs = 0;
+    double minNs = 0;
+    double p50Ns = 0;
+    double p90Ns = 0;
+    double p99Ns = 0;
+  };
+
+  class FIO_Benchmarks
+  {
+  public:
+    explicit FIO_Benchmarks( BenchmarkOptions const & options ) :
+      options( options )
+    {
+      try
+      {
+        fio = std::make_unique< FIO >( "C.UTF-8" );
+      }
+      catch ( std::runtime_error const & )
+      {
+        fio = std::make_unique< FIO >();
+      }
+
+      ownsDataDir = options.dataDir.empty();
+      dataDir = ownsDataDir ? ( fs::temp_directory_path() /
+                                ( "fio_bench_" + uniqueSuffix() ) )
+                                .string()
+                            : options.dataDir;
+    }
+
+    ~FIO_Benchmarks()
+    {
+      fio->clear();
+      std::error_code ignored;
+      if ( ownsDataDir ) { fs::remove_all( dataDir, ignored ); }
+    }
+
+    void generateData()
+    {
+      fs::create_directories( dataDir );
+      fio->storePathAtID( "bench", dataDir );
+
+      std::ofstream lines( dataDir + "/lines.txt", std::ios::binary );
+      for ( std::size_t i = 0; i < 200000 * options.scale; ++i )
+      {
+        lines << "line " << i << " the quick brown fox jumps over the lazy"
+              << " dog, " << ( i * 2654435761u ) % 1000003 << '\n';
+        ++lineCount;
+      }
+
+      std::ofstream csv( dataDir + "/wide.csv", std::ios::binary );
+      for ( std::size_t row = 0; row < 2000 * options.scale; ++row )
+      {
+        for ( std::size_t column = 0; column < 100; ++column )
+        {
+          csv << ( column ? "," : "" ) << ( row * 31 + column * 7 ) % 100000;
+        }
+        csv << '\n';
+      }
+      csvCells = 2000 * options.scale * 100;
+
+      std::ofstream unicode( dataDir + "/unicode.txt", std::ios::binary );
+      for ( std::size_t i = 0; i < 50000 * options.scale; ++i )
+      {
+        unicode << u8"Grüße aus Köln " << i << u8" — Ελληνικά, русский, "
+                << u8"日本語のテキスト, 中文, emoji 🚀\n";
+        ++unicodeLineCount;
+      }
+      lines.close();
+      csv.close();
+      unicode.close();
+
+      for ( std::size_t dir = 0; dir < 50 * options.scale; ++dir )
+      {
+        auto const path = dataDir + "/wide/" + std::to_string( dir );
+        fs::create_directories( path );
+        for ( std::size_t file = 0; file < 40; ++file )
+        {
+          std::ofstream( path + "/" + std::to_string( file ) +
+                         ( file % 4 ? ".dat" : ".txt" ) );
+          treeFiles[ "wide" ] += file % 4 ? 1 : 0;
+        }
+      }
+
+      std::string path = dataDir + "/deep";
+      for ( std::size_t depth = 0; depth < 40 * options.scale; ++depth )
+      {
+        path += "/" + std::to_string( depth );
+        fs::create_directories( path );
+        for ( std::size_t file = 0; file < 5; ++file )
+        {
+          std::ofstream( path + "/" + std::to_string( file ) + ".dat" );
+          ++treeFiles[ "deep" ];
+        }
+      }
+
+      for ( auto const & name : { "lines.txt", "wide.csv", "unicode.txt" } )
+      {
+        fileSizes[ name ] = fs::file_size( dataDir + "/" + name );
+      }
+    }
+
+    void runAllBenchmarks()
+    {
+      runReadBenchmarks();
+      runSplitBenchmarks();
+      runFileSearchBenchmarks();
+      runWriteBenchmarks();
+      runConversionBenchmarks();
+      runSyntaxHandlerBenchmarks();
+    }
+
+    void writeJSON( std::ostream & out ) const
+    {
+      out << "{\n  \"version\": 1,\n  \"scale\": " << options.scale
+          << ",\n  \"benchmarks\": [";
+      for ( std::size_t i = 0; i < results.size(); ++i )
+      {
+        auto const & it = results[ i ];
+        auto const seconds = it.p50Ns / 1e9;
+
+        out << ( i ? "," : "" ) << "\n    { \"name\": \"" << it.name
+            << "\", \"samples\": " << it.samples
+            << ", \"bytes_per_op\": " << it.bytesPerOp
+            << ", \"items_per_op\": " << it.itemsPerOp << std::fixed
+            << std::setprecision( 1 ) << ", \"mean_ns\": " << it.meanNs
+            << ", \"min_ns\": " << it.minNs << ", \"p50_ns\": " << it.p50Ns
+            << ", \"p90_ns\": " << it.p90Ns << ", \"p99_ns\": " << it.p99Ns
+            << std::setprecision( 3 ) << ", \"mb_per_s\": "
+            << ( seconds > 0 ? it.bytesPerOp / seconds / 1e6 : 0 )
+            << ", \"items_per_s\": "
+            << ( seconds > 0 ? it.itemsPerOp / seconds : 0 ) << " }";
+        out.unsetf( std::ios::floatfield );
+      }
+      out << "\n  ]\n}\n";
+    }
+
+    void writeSummary( std::ostream & out ) const
+    {
+      out << std::left << std::setw( 36 ) << "benchmark" << std::right
+          << std::setw( 12 ) << "p50 us" << std::setw( 12 ) << "p99 us"
+          << std::setw( 12 ) << "MB/s" << '\n';
+      for ( auto const & it : results )
+      {
+        out << std::left << std::setw( 36 ) << it.name << std::right
+            << std::fixed << std::setprecision( 1 ) << std::setw( 12 )
+            << it.p50Ns / 1e3 << std::setw( 12 ) << it.p99Ns / 1e3
+            << std::setw( 12 )
+            << ( it.bytesPerOp ? it.bytesPerOp / ( it.p50Ns / 1e9 ) / 1e6 : 0 )
+            << '\n';
+      }
+    }
+
+    /*
+      Compare the medians of this run against a JSON file written by an
+      earlier run, and report every benchmark which slowed down by more than
+      the threshold, or which the baseline has but this run is missing.
+      Benchmarks excluded by the filter are not expected. Throws if the
+      baseline was run at a different scale, whose timings are not
+      comparable. Returns the number of regressions and missing benchmarks.
+    */
+    std::size_t compareToBaseline( std::ostream & out ) const
+    {
+      std::ifstream in( options.baselinePath, std::ios::binary );
+      if ( ! in )
+      {
+        throw std::runtime_error( "Could not read the baseline: \"" +
+                                  options.baselinePath + "\"!" );
+      }
+      std::stringstream contents;
+      contents << in.rdbuf();
+
+      auto const baselineScale = parseScale( contents.str() );
+      if ( baselineScale != options.scale )
+      {
+        throw std::runtime_error(
+          "The baseline was run with --scale " +
+          std::to_string( baselineScale ) + ", but this run used --scale " +
+          std::to_string( options.scale ) + "!" );
+      }
+
+      auto const baseline = parseMedians( contents.str() );
+      std::size_t regressions = 0;
+
+      for ( auto const & it : results )
+      {
+        auto const found = baseline.find( it.name );
+        if ( found == baseline.end() || found->second <= 0 )
+        {
+          out << it.name << ": not in baseline\n";
+          continue;
+        }
+
+        auto const change = ( it.p50Ns / found->second - 1.0 ) * 100.0;
+        auto const regressed = change > options.threshold;
+
+        regressions += regressed;
+        out << it.name << ": " << std::showpos << std::fixed
+            << std::setprecision( 1 ) << change << std::noshowpos << "%"
+            << ( regressed ? " REGRESSION" : "" ) << '\n';
+      }
+
+      for ( auto const & it : baseline )
+      {
+        auto const ran = std::any_of(
+          results.begin(), results.end(), [ &it ]( auto const & result ) {
+            return result.name == it.first;
+          } );
+
+        if ( ! ran && it.first.find( options.filter ) != std::string::npos )
+        {
+          ++regressions;
+          out << it.first << ": MISSING from this run\n";
+        }
+      }
+      return regressions;
+    }
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    BenchmarkOptions const options;
+    std::unique_ptr< FIO > fio;
+    SyntaxHandler syntax;
+    std::string dataDir;
+    bool ownsDataDir = false;
+    std::size_t lineCount = 0;
+    std::size_t unicodeLineCount = 0;
+    std::size_t csvCells = 0;
+    std::map< std::string, std::size_t > treeFiles;
+    std::map< std::string, std::uintmax_t > fileSizes;
+    std::vector< BenchmarkResult > results;
+    // Results of every operation are folded in here so none are optimised out.
+    std::size_t volatile sink = 0;
+
+    static std::string uniqueSuffix()
+    {
+      return std::to_string( Clock::now().time_since_epoch().count() );
+    }
+
+    hstring benchPath( std::string const & name ) const
+    {
+      return fio->getPath( "bench" ) + PATH_SEP + name;
+    }
+
+    /*
+      Time operation until it has run for at least the minimum time and the
+      minimum number of samples, after one untimed warm-up run.
+    */
+    template < typename Operation >
+    void measure( std::string const & name,
+                  std::size_t const & bytesPerOp,
+                  std::size_t const & itemsPerOp,
+                  Operation && operation )
+    {
+      if ( name.find( options.filter ) == std::string::npos ) { return; }
+
+      sink = sink + operation();
+
+      std::vector< double > samples;
+      auto const deadline = Clock::now() + options.minTime;
+
+      while ( samples.size() < options.minSamples ||
+              ( Clock::now() < deadline &&
+                samples.size() < options.maxSamples ) )
+      {
+        auto const start = Clock::now();
+        sink = sink + operation();
+        samples.push_back( std::chrono::duration< double, std::nano >(
+                             Clock::now() - start )
+                             .count() );
+      }
+      std::sort( samples.begin(), samples.end() );
+
+      BenchmarkResult result;
+      result.name = name;
+      result.samples = samples.size();
+      result.bytesPerOp = bytesPerOp;
+      result.itemsPerOp = itemsPerOp;
+      for ( auto const & it : samples ) { result.meanNs += it; }
+      result.meanNs /= samples.size();
+      result.minNs = samples.front();
+      result.p50Ns = percentile( samples, 50 );
+      result.p90Ns = percentile( samples, 90 );
+      result.p99Ns = percentile( samples, 99 );
+      results.push_back( result );
+
+      std::cerr << "  " << name << '\n';
+    }
+
+    // Nearest-rank percentile of an already sorted set of samples.
+    static double percentile( std::vector< double > const & sorted,
+                              double const & percent )
+    {
+      auto const rank = static_cast< std::size_t >(
+        std::ceil( percent / 100.0 * sorted.size() ) );
+      return sorted[ std::max< std::size_t >( rank, 1 ) - 1 ];
+    }
+
+    // Pull the "scale" out of a results file, which is 1 if it is missing.
+    static std::size_t parseScale( std::string const & json )
+    {
+      std::string const scaleKey = "\"scale\": ";
+      auto const at = json.find( scaleKey );
+      if ( at == std::string::npos ) { return 1; }
+      return std::strtoul( json.c_str() + at + scaleKey.size(), nullptr, 10 );
+    }
+
+    // Pull every "name" and the "p50_ns" following it out of a results file.
+    static std::map< std::string, double > parseMedians(
+      std::string const & json )
+    {
+      std::map< std::string, double > medians;
+      std::string const nameKey = "\"name\": \"";
+      std::string const medianKey = "\"p50_ns\": ";
+
+      for ( auto at = json.find( nameKey ); at != std::string::npos;
+            at = json.find( nameKey, at ) )
+      {
+        at += nameKey.size();
+        auto const nameEnd = json.find( '"', at );
+        auto const median = json.find( medianKey, nameEnd );
+        if ( nameEnd == std::string::npos || median == std::string::npos )
+        {
+          break;
+        }
+        medians[ json.substr( at, nameEnd - at ) ] =
+          std::strtod( json.c_str() + median + medianKey.size(), nullptr );
+        at = median;
+      }
+      return medians;
+    }
+
+    void runReadBenchmarks()
+    {
+      auto const lines = benchPath( "lines.txt" );
+      auto const csv = benchPath( "wide.csv" );
+      auto const unicode = benchPath( "unicode.txt" );
+
+      measure( "readFile/lines", fileSizes[ "lines.txt" ], 1, [ & ]() {
+        return fio->readFile( lines ).str().size();
+      } );
+      measure( "readFile/unicode", fileSizes[ "unicode.txt" ], 1, [ & ]() {
+        return fio->readFile( unicode ).wstr().size();
+      } );
+      measure( "readFileToVector/lines",
+               fileSizes[ "lines.txt" ],
+               lineCount,
+               [ & ]() { return fio->readFileToVector( lines ).size(); } );
+      measure( "readFileToVector/unicode",
+               fileSizes[ "unicode.txt" ],
+               unicodeLineCount,
+               [ & ]() { return fio->readFileToVector( unicode ).size(); } );
+      measure( "readFileToMatrix/csv",
+               fileSizes[ "wide.csv" ],
+               csvCells,
+               [ & ]() { return fio->readFileToMatrix( csv ).size(); } );
+    }
+
+    void runSplitBenchmarks()
+    {
+      hstring const csv = fio->readFile( benchPath( "wide.csv" ) ).str();
+      hstring const unicode =
+        fio->readFile( benchPath( "unicode.txt" ) ).wstr();
+
+      measure( "splitString/csv", fileSizes[ "wide.csv" ], csvCells, [ & ]() {
+        return splitString( csv, ",\n" ).size();
+      } );
+      measure( "splitString/unicode",
+               fileSizes[ "unicode.txt" ],
+               unicodeLineCount,
+               [ & ]() { return splitString( unicode, L"\n" ).size(); } );
+      measure( "splitStringView/csv",
+               fileSizes[ "wide.csv" ],
+               csvCells,
+               [ & ]() { return splitStringView( csv.str(), ",\n" ).size(); } );
+    }
+
+    void runFileSearchBenchmarks()
+    {
+      for ( auto const & tree : { "wide", "deep" } )
+      {
+        auto const path = benchPath( tree );
+
+        measure( std::string( "findFiles/" ) + tree,
+                 0,
+                 treeFiles[ tree ],
+                 [ & ]() { return fio->findFiles( ".dat", path ).size(); } );
+      }
+
+      auto const path = benchPath( "wide" );
+
+      fio->indexDirectory( path, WatchChangesFalse );
+      measure( "findFiles/wide-indexed", 0, treeFiles[ "wide" ], [ & ]() {
+        return fio->findFiles( ".dat", path ).size();
+      } );
+      fio->removeDirectoryIndex( path );
+    }
+
+    void runWriteBenchmarks()
+    {
+      auto const path = benchPath( "written.txt" );
+      std::size_t const lines = 20000;
+      hstring const line = "line 123456 the quick brown fox jumps over it";
+
+      measure( "writeLine/lines",
+               lines * ( line.str().size() + 1 ),
+               lines,
+               [ & ]() {
+                 fio->openOutputStream( path );
+                 for ( std::size_t i = 0; i < lines; ++i )
+                 {
+                   fio->writeLine( path, line );
+                 }
+                 fio->closeOutputStream( path );
+                 return lines;
+               } );
+      deleteFile( path );
+    }
+
+    void runConversionBenchmarks()
+    {
+      std::string const ascii = fio->readFile( benchPath( "lines.txt" ) ).str();
+      std::string const unicode =
+        fio->readFile( benchPath( "unicode.txt" ) ).str();
+      std::wstring const wideAscii = hstring( ascii ).wstr();
+      std::wstring const wideUnicode = hstring( unicode ).wstr();
+
+      measure( "hstring/narrowToWide-ascii", ascii.size(), 1, [ & ]() {
+        return hstring( ascii ).wstr().size();
+      } );
+      measure( "hstring/wideToNarrow-ascii", ascii.size(), 1, [ & ]() {
+        return hstring( wideAscii ).str().size();
+      } );
+      measure( "hstring/narrowToWide-unicode", unicode.size(), 1, [ & ]() {
+        return hstring( unicode ).wstr().size();
+      } );
+      measure( "hstring/wideToNarrow-unicode", unicode.size(), 1, [ & ]() {
+        return hstring( wideUnicode ).str().size();
+      } );
+    }
+
+    void runSyntaxHandlerBenchmarks()
+    {
+      std::vector< std::string > lines;
+      std::vector< std::string > rows;
+      std::vector< std::string > quoted;
+      std::size_t lineBytes = 0;
+      std::size_t rowBytes = 0;
+      std::size_t rowCells = 0;
+      std::size_t quotedBytes = 0;
+
+      for ( auto const & it :
+            fio->readFileToVector( benchPath( "lines.txt" ) ) )
+      {
+        if ( lines.size() == 20000 ) { break; }
+        lines.push_back( "  " + it.str() + "   " );
+        lineBytes += lines.back().size();
+      }
+      for ( auto const & it : fio->readFileToVector( benchPath( "wide.csv" ) ) )
+      {
+        if ( rows.size() == 500 ) { break; }
+        rows.push_back( it.str() );
+        rowBytes += rows.back().size();
+        rowCells +=
+          std::count( rows.back().begin(), rows.back().end(), ',' ) + 1;
+      }
+      for ( std::size_t i = 0; i < 5000; ++i )
+      {
+        quoted.push_back( "play \"track " + std::to_string( i ) +
+                          "\" from \"the album\" on repeat" );
+        quotedBytes += quoted.back().size();
+      }
+
+      std::string arena;
+      for ( auto const & it : lines ) { arena += it + '\n'; }
+
+      // Each operation works on fresh copies, as the mutators work in place.
+      auto const forEachCopy = []( std::vector< std::string > const & in,
+                                         auto const & mutate ) {
+        std::size_t total = 0;
+        for ( auto copy : in )
+        {
+          mutate( copy );
+          total += copy.size();
+        }
+        return total;
+      };
+
+      measure( "SyntaxHandler/makeUpperCase",
+               lineBytes,
+               lines.size(),
+               [ & ]() {
+                 return forEachCopy( lines, [ this ]( std::string & s ) {
+                   syntax.makeUpperCase( s );
+                 } );
+               } );
+      measure( "SyntaxHandler/makeLowerCase",
+               lineBytes,
+               lines.size(),
+               [ & ]() {
+                 return forEachCopy( lines, [ this ]( std::string & s ) {
+                   syntax.makeLowerCase( s );
+                 } );
+               } );
+      measure( "SyntaxHandler/makeTitleCase",
+               lineBytes,
+               lines.size(),
+               [ & ]() {
+                 return forEachCopy( lines, [ this ]( std::string & s ) {
+                   syntax.makeTitleCase( s );
+                 } );
+               } );
+      measure( "SyntaxHandler/trimWhiteSpace",
+               lineBytes,
+               lines.size(),
+               [ & ]() {
+                 return forEachCopy( lines, [ this ]( std::string & s ) {
+                   syntax.trimWhiteSpace( s );
+                 } );
+               } );
+      measure( "SyntaxHandler/trimWhiteSpace-arena",
+               lineBytes,
+               lines.size(),
+               [ & ]() {
+                 auto copy = arena;
+                 syntax.trimWhiteSpace( copy, '\n' );
+                 return copy.size();
+               } );
+      measure( "SyntaxHandler/makeTitleCase-arena",
+               lineBytes,
+               lines.size(),
+               [ & ]() {
+                 auto copy = arena;
+                 syntax.makeTitleCase( copy, '\n' );
+                 return copy.size();
+               } );
+      measure( "SyntaxHandler/stripChar", rowBytes, rows.size(), [ & ]() {
+        return forEachCopy(
+          rows, [ this ]( std::string & s ) { syntax.stripChar( s, ',' ); } );
+      } );
+      measure( "SyntaxHandler/splitString", rowBytes, rowCells, [ & ]() {
+        std::size_t total = 0;
+        for ( auto const & it : rows )
+        {
+          total += syntax.splitString( it, ',' ).size();
+        }
+        return total;
+      } );
+      measure( "SyntaxHandler/splitStringsInQuotes",
+               quotedBytes,
+               quoted.size(),
+               [ & ]() {
+                 std::size_t total = 0;
+                 for ( auto const & it : quoted )
+                 {
+                   total += syntax.splitStringsInQuotes( it ).size();
+                 }
+                 return total;
+               } );
+      measure( "SyntaxHandler/startsWith", lineBytes, lines.size(), [ & ]() {
+        std::size_t total = 0;
+        for ( auto const & it : lines )
+        {
+          total += syntax.startsWith( it, "  line 1" );
+        }
+        return total;
+      } );
+      measure( "SyntaxHandler/endsWith", lineBytes, lines.size(), [ & ]() {
+        std::size_t total = 0;
+        for ( auto const & it : lines )
+        {
+          total += syntax.endsWith( it, "7   " );
+        }
+        return total;
+      } );
+      measure( "SyntaxHandler/centerString", lineBytes, lines.size(), [ & ]() {
+        std::size_t total = 0;
+        for ( auto const & it : lines )
+        {
+          total += syntax.centerString( it, 120 ).size();
+        }
+        return total;
+      } );
+    }
+  };
+}
+
+using namespace FIOBenchmarks;
+
+namespace
+{
+  char const * const usage =
+    "Usage: bench [--out file] [--baseline file] [--threshold percent]\n"
+    "             [--scale n] [--min-time ms] [--filter text] [--data dir]\n"
+    "\n"
+    "  --out file           Write the JSON results to file instead of stdout.\n"
+    "  --baseline file      Compare against the JSON results of an earlier\n"
+    "                       run, failing on regressions and on benchmarks\n"
+    "                       missing from this run. The baseline must\n"
+    "                       have been run with the same --scale.\n"
+    "  --threshold percent  The median slowdown counted as a regression.\n"
+    "                       Defaults to 10.\n"
+    "  --scale n            Multiply the size of the generated data by n.\n"
+    "  --min-time ms        The least time to run each benchmark for.\n"
+    "  --filter text        Only run the benchmarks whose name contains text.\n"
+    "  --data dir           Generate the data into dir.\n"
+    "  --help               Print this message.\n";
+}
+
+int main( int argc, char * argv[] )
+{
+  BenchmarkOptions options;
+
+  for ( int i = 1; i < argc; ++i )
+  {
+    std::string const argument = argv[ i ];
+    if ( argument == "--help" || argument == "-h" )
+    {
+      std::cout << usage;
+      return 0;
+    }
+    if ( i + 1 >= argc )
+    {
+      std::cerr << "Missing value for " << argument << '\n' << usage;
+      return 2;
+    }
+
+    std::string const value = argv[ ++i ];
+    if ( argument == "--out" ) { options.outputPath = value; }
+    else if ( argument == "--baseline" ) { options.baselinePath = value; }
+    else if ( argument == "--filter" ) { options.filter = value; }
+    else if ( argument == "--data" ) { options.dataDir = value; }
+    else if ( argument == "--threshold" )
+    {
+      options.threshold = std::stod( value );
+    }
+    else if ( argument == "--scale" )
+    {
+      options.scale = std::max( 1ul, std::stoul( value ) );
+    }
+    else if ( argument == "--min-time" )
+    {
+      options.minTime = std::chrono::milliseconds( std::stoul( value ) );
+    }
+    else
+    {
+      std::cerr << "Unknown option " << argument << '\n' << usage;
+      return 2;
+    }
+  }
+
+  try
+  {
+    FIO_Benchmarks benchmarks( options );
+
+    std::cerr << "Generating data...\n";
+    benchmarks.generateData();
+    std::cerr << "Running benchmarks...\n";
+    benchmarks.runAllBenchmarks();
+    benchmarks.writeSummary( std::cerr );
+
+    if ( options.outputPath.empty() ) { benchmarks.writeJSON( std::cout ); }
+    else
+    {
+      std::ofstream out( options.outputPath, std::ios::binary );
+      benchmarks.writeJSON( out );
+    }
+
+    if ( ! options.baselinePath.empty() &&
+         benchmarks.compareToBaseline( std::cerr ) > 0 )
+    {
+      return 1;
+    }
+  }
+  catch ( std::exception const & e )
+  {
+    std::cerr << e.what() << '\n';
+    return 2;
+  }
+
+  return 0;
+}
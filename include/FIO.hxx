@@ -26,63 +26,463 @@
 #ifndef HYBRID_STRING_H_
 #define HYBRID_STRING_H_
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cwchar>
 #include <locale>
+#include <mutex>
 #include <ostream>
 #include <string>
+#include <string_view>
+
+#if defined __AVX2__
+
+  #ifndef FIO_AVX2
+    #define FIO_AVX2
+  #endif
+
+#endif
+
+#if defined __SSE2__ || defined _M_X64 || \
+  ( defined _M_IX86_FP && _M_IX86_FP >= 2 )
+
+  #ifndef FIO_SSE2
+    #define FIO_SSE2
+  #endif
+
+#endif
+
+#if defined FIO_AVX2
+  #include <immintrin.h>
+#elif defined FIO_SSE2
+  #include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+  #include <intrin.h>
+#endif
+
+#ifndef _WIN32
+  #include <langinfo.h>
+#endif
 
 namespace hst
 {
-  // Turn a wide string into a multi-byte string.
+  // Check if the active C locale stores multi-byte strings as UTF-8.
+  inline static bool isUtf8Locale()
+  {
+#ifdef _WIN32
+    return false;
+#else
+    char const * const codeset = nl_langinfo( CODESET );
+
+    return codeset != nullptr && ( std::strcmp( codeset, "UTF-8" ) == 0 ||
+                                   std::strcmp( codeset, "utf8" ) == 0 );
+#endif
+  }
+
+  /*
+    Check if single-byte characters can be searched for directly inside
+    multi-byte strings of the active locale without splitting a multi-byte
+    sequence. This holds for ASCII characters in UTF-8 and in every
+    single-byte locale.
+  */
+  inline static bool isByteSearchable( std::wstring const & characters )
+  {
+    for ( wchar_t const & wideCharacter : characters )
+    {
+      if ( wideCharacter < 0 || wideCharacter > 0x7F ) { return false; }
+    }
+    return MB_CUR_MAX == 1 || isUtf8Locale();
+  }
+
+  /*
+    Turn a UTF-8 string into a wide string (UTF-32, or UTF-16 where wchar_t
+    is 16 bits wide). Runs of ASCII characters are widened 16 at a time.
+    Conversion stops at the first malformed sequence.
+  */
+  inline static std::wstring utf8ToWide( std::string_view const & str )
+  {
+    std::wstring wideString( str.size(), L'\0' );
+    auto const source = reinterpret_cast< unsigned char const * >( str.data() );
+    auto const size = str.size();
+    wchar_t * const target = &wideString[ 0 ];
+    std::size_t i = 0;
+    std::size_t j = 0;
+
+    while ( i < size )
+    {
+#if defined FIO_SSE2 || defined FIO_AVX2
+      __m128i const zero = _mm_setzero_si128();
+
+      while ( i + 16 <= size )
+      {
+        __m128i const chunk =
+          _mm_loadu_si128( reinterpret_cast< __m128i const * >( source + i ) );
+
+        if ( _mm_movemask_epi8( chunk ) != 0 ) { break; }
+
+        __m128i const low = _mm_unpacklo_epi8( chunk, zero );
+        __m128i const high = _mm_unpackhi_epi8( chunk, zero );
+
+        if ( sizeof( wchar_t ) == 2 )
+        {
+          _mm_storeu_si128( reinterpret_cast< __m128i * >( target + j ), low );
+          _mm_storeu_si128( reinterpret_cast< __m128i * >( target + j + 8 ),
+                            high );
+        }
+        else
+        {
+          auto const out = reinterpret_cast< __m128i * >( target + j );
+          _mm_storeu_si128( out, _mm_unpacklo_epi16( low, zero ) );
+          _mm_storeu_si128( out + 1, _mm_unpackhi_epi16( low, zero ) );
+          _mm_storeu_si128( out + 2, _mm_unpacklo_epi16( high, zero ) );
+          _mm_storeu_si128( out + 3, _mm_unpackhi_epi16( high, zero ) );
+        }
+        i += 16;
+        j += 16;
+      }
+      if ( i >= size ) { break; }
+#endif
+
+      std::uint32_t codePoint = source[ i ];
+      std::size_t length;
+
+      if ( codePoint < 0x80 ) { length = 1; }
+      else if ( ( codePoint & 0xE0 ) == 0xC0 )
+      {
+        length = 2;
+        codePoint &= 0x1F;
+      }
+      else if ( ( codePoint & 0xF0 ) == 0xE0 )
+      {
+        length = 3;
+        codePoint &= 0x0F;
+      }
+      else if ( ( codePoint & 0xF8 ) == 0xF0 )
+      {
+        length = 4;
+        codePoint &= 0x07;
+      }
+      else { break; }
+
+      if ( i + length > size ) { break; }
+
+      bool malformed = false;
+
+      for ( std::size_t k = 1; k < length; ++k )
+      {
+        if ( ( source[ i + k ] & 0xC0 ) != 0x80 )
+        {
+          malformed = true;
+          break;
+        }
+        codePoint = ( codePoint << 6 ) | ( source[ i + k ] & 0x3F );
+      }
+
+      std::uint32_t const minimumForLength[] = { 0, 0, 0x80, 0x800, 0x10000 };
+
+      if ( malformed || codePoint < minimumForLength[ length ] ||
+           codePoint > 0x10FFFF ||
+           ( codePoint >= 0xD800 && codePoint <= 0xDFFF ) )
+      {
+        break;
+      }
+
+      if ( sizeof( wchar_t ) == 2 && codePoint >= 0x10000 )
+      {
+        codePoint -= 0x10000;
+        target[ j++ ] =
+          static_cast< wchar_t >( 0xD800 + ( codePoint >> 10 ) );
+        target[ j++ ] =
+          static_cast< wchar_t >( 0xDC00 + ( codePoint & 0x3FF ) );
+      }
+      else { target[ j++ ] = static_cast< wchar_t >( codePoint ); }
+      i += length;
+    }
+
+    wideString.resize( j );
+    return wideString;
+  }
+
+  /*
+    Turn a wide string (UTF-32, or UTF-16 where wchar_t is 16 bits wide) into
+    a UTF-8 string. Runs of ASCII characters are narrowed 16 at a time.
+    Conversion stops at the first character which is not a valid code point.
+  */
+  inline static std::string wideToUtf8( std::wstring_view const & str )
+  {
+    std::string multiByteString( str.size(), '\0' );
+    auto const size = str.size();
+    std::size_t i = 0;
+    std::size_t j = 0;
+
+    while ( i < size )
+    {
+      // Every iteration writes at most 16 bytes.
+      if ( j + 16 > multiByteString.size() )
+      {
+        multiByteString.resize( 2 * multiByteString.size() + 16 );
+      }
+
+      char * const target = &multiByteString[ 0 ];
+
+#if defined FIO_SSE2 || defined FIO_AVX2
+      if ( i + 16 <= size )
+      {
+        auto const in = reinterpret_cast< __m128i const * >( str.data() + i );
+        __m128i narrow;
+        bool ascii;
+
+        if ( sizeof( wchar_t ) == 2 )
+        {
+          __m128i const low = _mm_loadu_si128( in );
+          __m128i const high = _mm_loadu_si128( in + 1 );
+          __m128i const nonAscii =
+            _mm_and_si128( _mm_or_si128( low, high ), _mm_set1_epi16( -0x80 ) );
+
+          ascii = _mm_movemask_epi8( _mm_cmpeq_epi16(
+                    nonAscii, _mm_setzero_si128() ) ) == 0xFFFF;
+          narrow = _mm_packus_epi16( low, high );
+        }
+        else
+        {
+          __m128i const a = _mm_loadu_si128( in );
+          __m128i const b = _mm_loadu_si128( in + 1 );
+          __m128i const c = _mm_loadu_si128( in + 2 );
+          __m128i const d = _mm_loadu_si128( in + 3 );
+          __m128i const nonAscii = _mm_and_si128(
+            _mm_or_si128( _mm_or_si128( a, b ), _mm_or_si128( c, d ) ),
+            _mm_set1_epi32( -0x80 ) );
+
+          ascii = _mm_movemask_epi8( _mm_cmpeq_epi32(
+                    nonAscii, _mm_setzero_si128() ) ) == 0xFFFF;
+          narrow = _mm_packus_epi16( _mm_packs_epi32( a, b ),
+                                     _mm_packs_epi32( c, d ) );
+        }
+
+        if ( ascii )
+        {
+          _mm_storeu_si128( reinterpret_cast< __m128i * >( target + j ),
+                            narrow );
+          i += 16;
+          j += 16;
+          continue;
+        }
+      }
+#endif
+
+      auto codePoint = static_cast< std::uint32_t >( str[ i++ ] );
+
+      if ( sizeof( wchar_t ) == 2 && codePoint >= 0xD800 &&
+           codePoint <= 0xDBFF && i < size )
+      {
+        auto const lowSurrogate = static_cast< std::uint32_t >( str[ i ] );
+
+        if ( lowSurrogate >= 0xDC00 && lowSurrogate <= 0xDFFF )
+        {
+          codePoint = 0x10000 + ( ( codePoint - 0xD800 ) << 10 ) +
+            ( lowSurrogate - 0xDC00 );
+          ++i;
+        }
+      }
+
+      if ( codePoint > 0x10FFFF ||
+           ( codePoint >= 0xD800 && codePoint <= 0xDFFF ) )
+      {
+        break;
+      }
+
+      if ( codePoint < 0x80 )
+      {
+        target[ j++ ] = static_cast< char >( codePoint );
+      }
+      else if ( codePoint < 0x800 )
+      {
+        target[ j++ ] = static_cast< char >( 0xC0 | ( codePoint >> 6 ) );
+        target[ j++ ] = static_cast< char >( 0x80 | ( codePoint & 0x3F ) );
+      }
+      else if ( codePoint < 0x10000 )
+      {
+        target[ j++ ] = static_cast< char >( 0xE0 | ( codePoint >> 12 ) );
+        target[ j++ ] =
+          static_cast< char >( 0x80 | ( ( codePoint >> 6 ) & 0x3F ) );
+        target[ j++ ] = static_cast< char >( 0x80 | ( codePoint & 0x3F ) );
+      }
+      else
+      {
+        target[ j++ ] = static_cast< char >( 0xF0 | ( codePoint >> 18 ) );
+        target[ j++ ] =
+          static_cast< char >( 0x80 | ( ( codePoint >> 12 ) & 0x3F ) );
+        target[ j++ ] =
+          static_cast< char >( 0x80 | ( ( codePoint >> 6 ) & 0x3F ) );
+        target[ j++ ] = static_cast< char >( 0x80 | ( codePoint & 0x3F ) );
+      }
+    }
+
+    multiByteString.resize( j );
+    return multiByteString;
+  }
+
+  /*
+    Turn a wide string into a multi-byte string. UTF-8 locales use the
+    vectorized transcoder, other locales convert one character at a time.
+  */
   inline static std::string wideToMultiByte( std::wstring const & str )
   {
+    if ( isUtf8Locale() ) { return wideToUtf8( str ); }
+
     std::string multiByteString;
     std::string multiByteCharacterBuffer( MB_CUR_MAX, '\0' );
 
+    multiByteString.reserve( str.size() );
     for ( wchar_t const & wideCharacter : str )
     {
       int multiByteCharacterLength =
         std::wctomb( &multiByteCharacterBuffer[ 0 ], wideCharacter );
 
       if ( multiByteCharacterLength < 1 ) { break; }
-      multiByteString +=
-        multiByteCharacterBuffer.substr( 0, multiByteCharacterLength );
+      multiByteString.append( multiByteCharacterBuffer.data(),
+                              multiByteCharacterLength );
     }
 
     return multiByteString;
   }
 
-  // Turn a multi-byte string into a wide string.
+  /*
+    Check if a multi-byte string converted from a wide string holds all of
+    its characters. Conversions stop at the first character the active
+    locale cannot represent, which leaves fewer characters behind.
+  */
+  inline static bool isCompleteConversion( std::wstring const & wideString,
+                                           std::string const & multiByteString )
+  {
+    std::size_t wideLength = wideString.size();
+    std::size_t multiByteLength = 0;
+
+    if ( sizeof( wchar_t ) == 2 )
+    {
+      // Surrogate pairs are one character.
+      wideLength -= std::count_if(
+        wideString.begin(), wideString.end(), []( wchar_t const & c ) {
+          return c >= 0xDC00 && c <= 0xDFFF;
+        } );
+    }
+    if ( isUtf8Locale() )
+    {
+      for ( char const & c : multiByteString )
+      {
+        multiByteLength += ( c & 0xC0 ) != 0x80;
+      }
+      return multiByteLength == wideLength;
+    }
+
+    std::mbstate_t state {};
+    char const * source = multiByteString.c_str();
+    char const * const end = source + multiByteString.size();
+
+    while ( source < end )
+    {
+      auto const length = std::mbrlen( source, end - source, &state );
+
+      if ( length == 0 || length > static_cast< std::size_t >( end - source ) )
+      {
+        return false;
+      }
+      source += length;
+      ++multiByteLength;
+    }
+    return multiByteLength == wideLength;
+  }
+
+  /*
+    Turn a multi-byte string into a wide string. UTF-8 locales use the
+    vectorized transcoder, other locales use the C library. Conversion stops
+    at the first malformed sequence.
+  */
   inline static std::wstring multiByteToWide( std::string const & str )
   {
+    if ( isUtf8Locale() ) { return utf8ToWide( str ); }
+
     std::wstring wideString( str.size(), L' ' );
+    auto const convertedLength =
+      std::mbstowcs( &wideString[ 0 ], str.c_str(), str.size() );
+
+    if ( convertedLength != static_cast< std::size_t >( -1 ) )
+    {
+      wideString.resize( convertedLength );
+      return wideString;
+    }
 
-    wideString.resize(
-      std::mbstowcs( &wideString[ 0 ], str.c_str(), str.size() ) );
+    // Keep every character in front of the malformed sequence.
+    std::mbstate_t state {};
+    char const * source = str.c_str();
+    std::size_t i = 0;
 
+    while ( i < wideString.size() )
+    {
+      auto const length = std::mbrtowc(
+        &wideString[ i ], source, str.c_str() + str.size() - source, &state );
+
+      if ( length == 0 || length == static_cast< std::size_t >( -1 ) ||
+           length == static_cast< std::size_t >( -2 ) )
+      {
+        break;
+      }
+      source += length;
+      ++i;
+    }
+    wideString.resize( i );
     return wideString;
   }
 
-  // A string wrapper class for conversion between multi-byte and wide strings.
+  /*
+    A string wrapper class for conversion between multi-byte and wide strings.
+    Only the encoding a hstring is created from is stored up front; the other
+    encoding is converted on first request and cached. Filling the cache is
+    safe from several threads at once, so a const hstring may be shared like
+    a const std::string.
+  */
   class hstring
   {
     public:
-    hstring() : multiByteString( "" ), wideString( L"" ) {}
+    hstring() = default;
 
     ~hstring() = default;
 
     hstring( hstring const & hstr ) :
-      multiByteString( hstr.multiByteString ), wideString( hstr.wideString )
+      multiByteString( hstr.isWide ? std::string() : hstr.multiByteString ),
+      wideString( hstr.isWide ? hstr.wideString : std::wstring() ),
+      isWide( hstr.isWide ),
+      hasConversion( false )
     {
+      if ( hstr.hasConversion.load( std::memory_order_acquire ) )
+      {
+        if ( isWide ) { multiByteString = hstr.multiByteString; }
+        else { wideString = hstr.wideString; }
+        hasConversion.store( true, std::memory_order_relaxed );
+      }
     }
 
     hstring( hstring && hstr ) noexcept :
       multiByteString( std::move( hstr.multiByteString ) ),
-      wideString( std::move( hstr.wideString ) )
+      wideString( std::move( hstr.wideString ) ),
+      isWide( hstr.isWide ),
+      hasConversion( hstr.hasConversion.load( std::memory_order_relaxed ) )
     {
+      hstr.clear();
     }
 
     hstring( std::wstring const & wstr ) :
-      multiByteString( wideToMultiByte( wstr ) ), wideString( wstr )
+      wideString( wstr ), isWide( true ), hasConversion( false )
+    {
+    }
+
+    hstring( std::wstring && wstr ) noexcept :
+      wideString( std::move( wstr ) ), isWide( true ), hasConversion( false )
     {
     }
 
@@ -91,7 +491,12 @@ namespace hst
     hstring( wchar_t const & wc ) : hstring( std::wstring( 1, wc ) ) {}
 
     hstring( std::string const & mbstr ) :
-      multiByteString( mbstr ), wideString( multiByteToWide( mbstr ) )
+      multiByteString( mbstr ), hasConversion( false )
+    {
+    }
+
+    hstring( std::string && mbstr ) noexcept :
+      multiByteString( std::move( mbstr ) ), hasConversion( false )
     {
     }
 
@@ -101,8 +506,7 @@ namespace hst
 
     hstring & operator=( hstring const & hstr )
     {
-      multiByteString = hstr.multiByteString;
-      wideString = hstr.wideString;
+      if ( this != &hstr ) { *this = hstring( hstr ); }
       return *this;
     }
 
@@ -112,14 +516,34 @@ namespace hst
       {
         multiByteString = std::move( hstr.multiByteString );
         wideString = std::move( hstr.wideString );
+        isWide = hstr.isWide;
+        hasConversion.store(
+          hstr.hasConversion.load( std::memory_order_relaxed ),
+          std::memory_order_relaxed );
+        hstr.clear();
       }
       return *this;
     }
 
+    // Appends in the stored encoding, so appending never loses characters
+    // the other encoding cannot represent.
     hstring & operator+=( hstring const & hstr )
     {
-      wideString += hstr.wideString;
-      multiByteString += hstr.multiByteString;
+      if ( isWide ? wideString.empty() : multiByteString.empty() )
+      {
+        return *this = hstr;
+      }
+      if ( isWide )
+      {
+        wideString += hstr.wstr();
+        multiByteString.clear();
+      }
+      else
+      {
+        multiByteString += hstr.str();
+        wideString.clear();
+      }
+      hasConversion.store( false, std::memory_order_relaxed );
       return *this;
     }
 
@@ -128,10 +552,23 @@ namespace hst
       return lhs += rhs;
     }
 
+    // Strings are compared in the wide encoding unless both are stored as
+    // multi-byte strings. A multi-byte string which does not convert
+    // completely never matches a wide one, since the conversion stops at
+    // the first malformed character.
     friend bool operator==( hstring const & lhs, hstring const & rhs )
     {
-      return lhs.multiByteString == rhs.multiByteString &&
-        lhs.wideString == rhs.wideString;
+      if ( lhs.isWide == rhs.isWide )
+      {
+        return lhs.isWide ? lhs.wideString == rhs.wideString
+                          : lhs.multiByteString == rhs.multiByteString;
+      }
+
+      auto const & multiByte = lhs.isWide ? rhs : lhs;
+
+      return isCompleteConversion( multiByte.wstr(),
+                                   multiByte.multiByteString ) &&
+        lhs.wstr() == rhs.wstr();
     }
 
     friend bool operator!=( hstring const & lhs, hstring const & rhs )
@@ -139,21 +576,74 @@ namespace hst
       return ! ( lhs == rhs );
     }
 
-    operator std::wstring() const { return wideString; }
+    operator std::wstring() const { return wstr(); }
+
+    // The wide encoding, converted on first use. Valid until modified.
+    std::wstring const & wstr() const
+    {
+      if ( ! isWide ) { convert(); }
+      return wideString;
+    }
 
-    std::wstring wstr() const { return operator std::wstring(); }
+    wchar_t const * wc_str() const { return wstr().c_str(); }
 
-    wchar_t const * wc_str() const { return wideString.c_str(); }
+    operator std::string() const { return str(); }
 
-    operator std::string() const { return multiByteString; }
+    // The multi-byte encoding, converted on first use. Valid until modified.
+    std::string const & str() const
+    {
+      if ( isWide ) { convert(); }
+      return multiByteString;
+    }
 
-    std::string str() const { return operator std::string(); }
+    char const * mb_str() const { return str().c_str(); }
 
-    char const * mb_str() const { return multiByteString.c_str(); }
+    // Check if the hstring stores its wide encoding, rather than converting
+    // to it on request.
+    bool storesWide() const { return isWide; }
 
     private:
-    std::string multiByteString;
-    std::wstring wideString;
+    // Resets to the empty string, as left behind by a move.
+    void clear() noexcept
+    {
+      multiByteString.clear();
+      wideString.clear();
+      isWide = false;
+      hasConversion.store( true, std::memory_order_relaxed );
+    }
+
+    // Converts the stored encoding into the other one, once.
+    void convert() const
+    {
+      if ( hasConversion.load( std::memory_order_acquire ) ) { return; }
+
+      std::lock_guard< std::mutex > guard( conversionLock( this ) );
+
+      if ( ! hasConversion.load( std::memory_order_relaxed ) )
+      {
+        if ( isWide ) { multiByteString = wideToMultiByte( wideString ); }
+        else { wideString = multiByteToWide( multiByteString ); }
+        hasConversion.store( true, std::memory_order_release );
+      }
+    }
+
+    // One of a fixed set of locks serializing the conversions of hstrings,
+    // picked by address so that unrelated strings rarely contend.
+    static std::mutex & conversionLock( void const * const str )
+    {
+      static std::mutex locks[ 64 ];
+
+      return locks[ ( reinterpret_cast< std::uintptr_t >( str ) >> 4 ) % 64 ];
+    }
+
+    // The multi-byte encoding, stored unless isWide is set.
+    mutable std::string multiByteString;
+    // The wide encoding, stored if isWide is set.
+    mutable std::wstring wideString;
+    // Whether the wide encoding is the stored one.
+    bool isWide = false;
+    // Whether the encoding which is not stored has been converted.
+    mutable std::atomic< bool > hasConversion{ true };
   };
 
   inline static std::ostream & operator<<( std::ostream & stream,
@@ -175,13 +665,36 @@ namespace hst
 #define FILE_INPUT_OUTPUT_H_
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
 #include <cstdio>
+#include <deque>
+#include <exception>
 #include <fstream>
+#include <functional>
+#include <iomanip>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <set>
+#include <shared_mutex>
 #include <sstream>
 #include <stdexcept>
+#include <string_view>
 #include <sys/stat.h>
+#include <system_error>
+#include <thread>
+#include <tuple>
+#include <type_traits>
 #include <unordered_map>
+#include <utility>
+#include <variant>
 #include <vector>
 
 #if defined WIN32 || defined _WIN32 || defined __WIN32 && ! defined __CYGWIN__
@@ -201,7 +714,18 @@ namespace hst
 #else
   #include <dirent.h>
   #include <errno.h>
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/uio.h>
   #include <unistd.h>
+  #ifdef __linux__
+    #include <linux/fs.h>
+    #include <poll.h>
+    #include <sys/eventfd.h>
+    #include <sys/inotify.h>
+    #include <sys/ioctl.h>
+    #include <sys/sendfile.h>
+  #endif
 #endif
 
 namespace FileIO
@@ -244,6 +768,142 @@ namespace FileIO
   static std::vector< hst::hstring > splitString(
     hst::hstring const & source, hst::hstring const & delim = L"\n\r" );
 
+  /*
+    Split a multi-byte string on one or more single-byte delimiters without
+    copying it. The returned views point into source, and follow the same
+    rules as splitString.
+    Ex: splitStringView( "The,Quick,,Fox", "," ) -> [ "The", "Quick", "Fox" ]
+  */
+  static std::vector< std::string_view > splitStringView(
+    std::string_view const & source, std::string_view const & delim = "\n\r" );
+
+  /*
+    A set of single-byte delimiting characters which can be searched for in a
+    multi-byte string. Sets of up to four delimiters are searched for with
+    SSE2 or AVX2 where available, larger sets use a lookup table.
+    Ex: DelimiterSet( ",|" ).find( "The,Quick", 0 ) -> 3
+  */
+  class DelimiterSet
+  {
+    public:
+    explicit DelimiterSet( std::string_view const & delim = "\n\r" );
+
+    /*
+      Retrieve the position of the first delimiter in source at or after
+      start, or std::string_view::npos if there is none.
+    */
+    std::size_t find( std::string_view const & source,
+                      std::size_t start = 0 ) const;
+
+    // Check if a character is one of the delimiters.
+    bool contains( char const & c ) const
+    {
+      return isDelimiter[ static_cast< unsigned char >( c ) ];
+    }
+
+    private:
+    // The most delimiters searched for with vector instructions.
+    static std::size_t const constexpr MaxVectorDelimiters = 4;
+
+    // Lookup table of all delimiters, indexed by unsigned byte value.
+    bool isDelimiter[ 256 ] = {};
+    // The delimiters, if there are few enough to search for in parallel.
+    char vectorDelimiters[ MaxVectorDelimiters ] = {};
+    // The number of entries in vectorDelimiters, or 0 to use the table.
+    std::size_t vectorDelimiterCount = 0;
+  };
+
+  /*
+    Split a multi-byte string on a set of single-byte delimiters in a single
+    pass, without copying or allocating. Tokens are views into the source,
+    and empty tokens are skipped in the same way as splitString.
+    Ex: for ( auto token : Tokenizer( "The,Quick,,Fox", "," ) ) ->
+      "The", "Quick", "Fox"
+  */
+  class Tokenizer
+  {
+    public:
+    class iterator
+    {
+      public:
+      using iterator_category = std::input_iterator_tag;
+      using value_type = std::string_view;
+      using difference_type = std::ptrdiff_t;
+      using pointer = std::string_view const *;
+      using reference = std::string_view const &;
+
+      iterator() = default;
+
+      reference operator*() const { return token; }
+
+      pointer operator->() const { return &token; }
+
+      iterator & operator++()
+      {
+        if ( ! tokenizer->next( position, token ) ) { tokenizer = nullptr; }
+        return *this;
+      }
+
+      iterator operator++( int )
+      {
+        auto const previous = *this;
+        ++*this;
+        return previous;
+      }
+
+      friend bool operator==( iterator const & lhs, iterator const & rhs )
+      {
+        return lhs.tokenizer == rhs.tokenizer &&
+          ( lhs.tokenizer == nullptr || lhs.position == rhs.position );
+      }
+
+      friend bool operator!=( iterator const & lhs, iterator const & rhs )
+      {
+        return ! ( lhs == rhs );
+      }
+
+      private:
+      friend class Tokenizer;
+
+      iterator( Tokenizer const * tok ) : tokenizer( tok ) { ++*this; }
+
+      // The tokenizer being iterated over, or nullptr at the end.
+      Tokenizer const * tokenizer = nullptr;
+      // The position in the source just past the current token.
+      std::size_t position = 0;
+      // The current token.
+      std::string_view token;
+    };
+
+    Tokenizer( std::string_view const & source,
+               std::string_view const & delim = "\n\r" ) :
+      source( source ), delimiters( delim )
+    {
+    }
+
+    Tokenizer( std::string_view const & source,
+               DelimiterSet const & delimiters ) :
+      source( source ), delimiters( delimiters )
+    {
+    }
+
+    iterator begin() const { return iterator( this ); }
+
+    iterator end() const { return iterator(); }
+
+    /*
+      Retrieve the first non-empty token at or after position, and advance
+      position past it. Returns false once the source is exhausted.
+    */
+    bool next( std::size_t & position, std::string_view & token ) const;
+
+    private:
+    // The string being split.
+    std::string_view source;
+    // The characters to split on.
+    DelimiterSet delimiters;
+  };
+
   /*
     Given a complete filepath to a file, permanently deletes it.
     Ex: deleteFile( "/dir/img/i.jpg" ) -> "/dir/img/i.jpg" is permanently
@@ -261,591 +921,6266 @@ namespace FileIO
   // File search sub-directory exclusion mode.
   bool const constexpr RecursiveSearchFalse = false;
 
-  // Simplifies filesystem interaction for applications.
-  class FIO
+  /*
+    A read-only view of a file's contents, mapped directly into memory. The
+    mapping is owned by the MappedFile and released when it is destroyed, so
+    views retrieved from it must not outlive it. Files which cannot be mapped
+    (empty files, pipes, and pseudo-files) are read into an owned buffer
+    instead.
+    Ex: MappedFile( "/dir/data/file.txt" ).view() -> the bytes of
+      "/dir/data/file.txt"
+  */
+  class MappedFile
   {
     public:
-    /*
-      Construct an FIO object using a given locale for string conversions. The
-      default locale is the user environment's locale.
-    */
-    FIO( hst::hstring const & loc = "" );
-    FIO( FIO const & ) = delete;
-    FIO & operator=( FIO const & ) = delete;
-    ~FIO() = default;
+    MappedFile() = default;
+    explicit MappedFile( hst::hstring const & pathToFile );
+    MappedFile( MappedFile const & ) = delete;
+    MappedFile & operator=( MappedFile const & ) = delete;
+    MappedFile( MappedFile && other ) noexcept;
+    MappedFile & operator=( MappedFile && other ) noexcept;
+    ~MappedFile();
 
-    /*
-      Clear FIO to its initial state. Safely closes all filestreams, and clears
-      all internal mappings.
-    */
-    FIO & clear();
+    // The unaltered bytes of the file.
+    std::string_view view() const;
 
-    /*
-      Open a wide input stream on the filepath pointed to by pathOrID. If
-      pathOrID is a stored ID, the ID's target will be used as the stream
-      source, otherwise pathOrID will be used as the stream source.
-      Ex: Path Map contains [ { "data", "/dir/data/file.txt" } ]
-        openInputStream( "data" ) -> reads from filepath "/dir/data/file.txt"
-        openInputStream( "/dir/data/file.txt" ) ->
-          reads from filepath "/dir/data/file.txt"
-      openInputStream( "/dir/data/desc/spawnpoints.txt" ->
-        reads from filepath "/dir/data/desc/spawnpoints.txt" )
-    */
-    std::wistream & openInputStream( hst::hstring const & pathOrID );
+    operator std::string_view() const { return view(); }
 
-    /*
-      Open a wide output stream on the filepath pointed to by pathOrID. If
-      pathOrID is a stored ID, the ID's target will be used as the stream
-      target, otherwise pathOrID will be used as the stream target.
-      Optionally, the new wide output stream can be opened in append mode.
-      Ex: Path Map contains [ { "data", "/dir/data/file.txt" } ]
-        openOutputStream( "data" ) -> writes to filepath "/dir/data/file.txt"
-        openOutputStream( "/dir/data/file.txt" ) ->
-          writes to filepath "/dir/data/file.txt"
-        openOutputStream( "/dir/data/desc/spawnpoints.txt" ->
-          writes to filepath "/dir/data/desc/spawnpoints.txt" )
-    */
-    std::wostream & openOutputStream( hst::hstring const & pathOrID,
-                                      bool const & appendToFile = OpenNewFile );
+    char const * data() const { return view().data(); }
 
-    /*
-      Rewind a previously opened input stream pointed to by pathOrID. If
-      pathOrID is a stored ID, the ID's target will be used as the rewind
-      target, otherwise pathOrID will be used as the rewind target.
-      Ex: Path Map contains [ { "data", "/dir/data/file.txt" } ]
-        rewindInputStream( "data" ) -> rewinds the input stream stored
-          under"/dir/data/file.txt"
-    */
-    std::wistream & rewindInputStream( hst::hstring const & streamID );
+    std::size_t size() const { return view().size(); }
+
+    bool empty() const { return size() == 0; }
+
+    // Copy the bytes of the file into a new string.
+    std::string str() const { return std::string( view() ); }
+
+    private:
+    // Unmaps the file and returns the MappedFile to its empty state.
+    void release() noexcept;
+
+    // The start of the mapped region, or nullptr if nothing is mapped.
+    char const * mappedData = nullptr;
+    // The length of the mapped region.
+    std::size_t mappedSize = 0;
+    // Fallback storage for files which could not be mapped.
+    std::string bufferedData;
+#ifdef WINDOWS
+    // The handle of the mapping object backing mappedData.
+    HANDLE mappingHandle = NULL;
+#endif
+  };
+
+  /*
+    Reads the records of a file one at a time in constant memory, however
+    large the file. Records are the non-empty runs of bytes between single-
+    byte delimiters, skipped in the same way as splitString. The file is read
+    into a fixed ring of large buffers, which a read-ahead thread keeps
+    filled while records are taken from the buffer before it. A record
+    crossing the end of a buffer is joined in a separate carry-over buffer,
+    so memory use is bounded by the ring plus the longest record.
+    Ex: for ( auto record : RecordReader( "/dir/big.csv" ) ) ->
+      each line of "/dir/big.csv", as a std::string_view valid until the
+      next record is read
+  */
+  class RecordReader
+  {
+    public:
+    class iterator
+    {
+      public:
+      using iterator_category = std::input_iterator_tag;
+      using value_type = std::string_view;
+      using difference_type = std::ptrdiff_t;
+      using pointer = std::string_view const *;
+      using reference = std::string_view const &;
+
+      iterator() = default;
+
+      reference operator*() const { return record; }
+
+      pointer operator->() const { return &record; }
+
+      iterator & operator++()
+      {
+        if ( ! reader->next( record ) ) { reader = nullptr; }
+        return *this;
+      }
+
+      friend bool operator==( iterator const & lhs, iterator const & rhs )
+      {
+        return lhs.reader == rhs.reader;
+      }
+
+      friend bool operator!=( iterator const & lhs, iterator const & rhs )
+      {
+        return ! ( lhs == rhs );
+      }
+
+      private:
+      friend class RecordReader;
+
+      iterator( RecordReader * rr ) : reader( rr ) { ++*this; }
+
+      // The reader being iterated over, or nullptr at the end.
+      RecordReader * reader = nullptr;
+      // The current record.
+      std::string_view record;
+    };
+
+    // The default size of each buffer in the ring.
+    static std::size_t const constexpr DefaultBufferSize = 1 << 20;
+    // The default number of buffers in the ring.
+    static std::size_t const constexpr DefaultBufferCount = 4;
+
+    explicit RecordReader(
+      hst::hstring const & pathToFile,
+      std::string_view const & delim = "\n\r",
+      std::size_t const & bufferSize = DefaultBufferSize,
+      std::size_t const & bufferCount = DefaultBufferCount );
+
+    // Iterates over the remaining records. A reader can be iterated once.
+    iterator begin() { return iterator( this ); }
+
+    iterator end() { return iterator(); }
 
     /*
-      Close a previously opened input stream pointed to by pathOrID. If
-      pathOrID is a stored ID, the ID's target will be used to close the
-      target stream, otherwise pathOrID will be used to close the target
-      stream.
-      Ex: Path Map contains [ { "data", "/dir/data/file.txt" } ]
-        closeInputStream( "data" ) -> closes the input stream stored
-          under"/dir/data/file.txt"
+      Retrieve the next record. Returns false once the file is exhausted.
+      The record stays valid until the next call.
     */
-    FIO & closeInputStream( hst::hstring const & pathOrID );
+    bool next( std::string_view & record );
+
+    private:
+    // The ring of buffers, and the thread filling it.
+    struct ReadAhead
+    {
+      ReadAhead( hst::hstring const & pathToFile,
+                 std::size_t const & bufferSize,
+                 std::size_t const & bufferCount );
+      ~ReadAhead();
+
+      // The main loop of the read-ahead thread.
+      void fill();
+      // Reads up to size bytes, stopping early only at the end of the file.
+      // Returns the number of bytes read, or -1 on errors.
+      std::ptrdiff_t readFully( char * target, std::size_t const & size );
+
+      // The file being read, for error messages.
+      hst::hstring path;
+#ifdef WINDOWS
+      HANDLE fileHandle = INVALID_HANDLE_VALUE;
+#else
+      int fileDescriptor = -1;
+#endif
+      // The capacity of each buffer.
+      std::size_t bufferSize;
+      // The buffers of the ring, used in order.
+      std::vector< std::unique_ptr< char[] > > buffers;
+      // The number of bytes filled in each buffer.
+      std::vector< std::size_t > filledSizes;
+
+      // Guards the counters and flags below.
+      std::mutex lock;
+      // Wakes the read-ahead thread and the reader.
+      std::condition_variable changed;
+      // The number of buffers filled so far.
+      std::size_t filled = 0;
+      // The number of buffers handed back by the reader so far.
+      std::size_t released = 0;
+      // Set once the whole file has been read.
+      bool finished = false;
+      // Set when the reader is being destroyed.
+      bool stopping = false;
+      // The error code of a failed read, or 0.
+      int error = 0;
+      // The read-ahead thread.
+      std::thread reader;
+    };
+
+    // Hands the current buffer back, and waits for the next one to be
+    // filled. Returns false at the end of the file.
+    bool nextBuffer();
+
+    // The delimiters separating records.
+    DelimiterSet delimiters;
+    // The buffers being read.
+    std::unique_ptr< ReadAhead > readAhead;
+    // The filled part of the current buffer.
+    std::string_view buffer;
+    // The position in buffer just past the last record.
+    std::size_t position = 0;
+    // Whether buffer is a buffer of the ring which must be handed back.
+    bool holdingBuffer = false;
+    // The start of a record crossing buffers, or the whole of such a record.
+    std::string carry;
+  };
+
+  class TaskGroup;
+
+  /*
+    A work-stealing pool of worker threads. Every worker owns a task queue.
+    Tasks submitted from a worker are pushed onto its own queue, tasks
+    submitted from other threads are spread across all queues, and workers
+    which run out of tasks steal from the other queues. Tasks are submitted
+    and waited on through a TaskGroup.
+  */
+  class TaskPool
+  {
+    public:
+    explicit TaskPool( std::size_t const & threadCount =
+                         std::thread::hardware_concurrency() );
+    TaskPool( TaskPool const & ) = delete;
+    TaskPool & operator=( TaskPool const & ) = delete;
+    ~TaskPool();
+
+    // The process-wide pool, started on first use.
+    static TaskPool & shared();
+
+    // The number of worker threads in the pool.
+    std::size_t size() const { return threads.size(); }
+
+    private:
+    friend class TaskGroup;
+
+    // A task, and the group waiting on it.
+    struct Task
+    {
+      std::function< void() > function;
+      TaskGroup * group;
+    };
+
+    // A worker's task queue.
+    struct TaskQueue
+    {
+      std::mutex lock;
+      std::deque< Task > tasks;
+    };
 
+    // Queue a task, preferring the calling worker's own queue.
+    void submit( Task && task );
     /*
-      Close a previously opened output stream pointed to by pathOrID. If
-      pathOrID is a stored ID, the ID's target will be used to close the
-      target stream, otherwise pathOrID will be used to close the target
-      stream.
-      Ex: Path Map contains [ { "data", "/dir/data/file.txt" } ]
-        closeOutputStream( "data" ) -> closes the output stream stored
-          under"/dir/data/file.txt"
+      Run one queued task on the calling thread, starting the search at the
+      calling worker's own queue. Only tasks of group are run, unless group
+      is nullptr. Returns false if no such task was queued.
     */
-    FIO & closeOutputStream( hst::hstring const & pathOrID );
+    bool runOne( TaskGroup const * const & group = nullptr );
+    // The main loop of the worker at index.
+    void work( std::size_t const & index );
+
+    // One queue per worker.
+    std::vector< std::unique_ptr< TaskQueue > > queues;
+    // The worker threads.
+    std::vector< std::thread > threads;
+    // The number of tasks in all queues.
+    std::atomic< std::size_t > queuedTasks { 0 };
+    // Round-robin counter for tasks submitted from outside the pool.
+    std::atomic< std::size_t > nextQueue { 0 };
+    // Guards sleeping workers and stopping.
+    std::mutex sleepLock;
+    // Wakes sleeping workers when tasks are queued.
+    std::condition_variable wakeUp;
+    // Set when the pool is destroyed.
+    bool stopping = false;
+  };
+
+  /*
+    A set of tasks run on a TaskPool which can be waited on together. A
+    thread waiting on a group runs the group's queued tasks instead of
+    blocking, so tasks may start and wait on groups of their own. Tasks of
+    other groups are never run by a waiting thread, so waiting while holding
+    a lock only other groups' tasks take cannot deadlock. The first
+    exception thrown by a task is rethrown by wait().
+    Ex: TaskGroup group; group.run( [] { work(); } ); group.wait();
+  */
+  class TaskGroup
+  {
+    public:
+    explicit TaskGroup( TaskPool & pool = TaskPool::shared() ) : pool( pool ) {}
+    TaskGroup( TaskGroup const & ) = delete;
+    TaskGroup & operator=( TaskGroup const & ) = delete;
+    ~TaskGroup();
+
+    // Queue a task on the pool.
+    TaskGroup & run( std::function< void() > task );
+
+    // Wait for every task run so far to finish.
+    void wait();
+
+    // Run one queued task of the group on the calling thread. Returns false
+    // if none was queued.
+    bool runOne() { return pool.runOne( this ); }
+
+    // Check if every task run so far has finished.
+    bool done() const { return pendingTasks.load() == 0; }
+
+    private:
+    friend class TaskPool;
+
+    // Marks one task as finished, recording its exception, if any.
+    void finish( std::exception_ptr const & taskError );
+
+    // The pool tasks are run on.
+    TaskPool & pool;
+    // The number of tasks which have not yet finished.
+    std::atomic< std::size_t > pendingTasks { 0 };
+    // Guards error and wakes waiting threads.
+    std::mutex lock;
+    std::condition_variable finished;
+    // The first exception thrown by a task.
+    std::exception_ptr error;
+  };
+
+  /*
+    Hands the results of a TaskGroup's tasks to the thread waiting on it.
+    Results are consumed on the waiting thread without any lock held, so
+    consumers may run and wait on tasks of their own. Must outlive the
+    tasks pushing to it.
+    Ex: results.push( read( file ) ) in each task, then
+      results.drain( group, []( Contents && c ) { parse( c ); } )
+  */
+  template < typename Result >
+  class ResultQueue
+  {
+    public:
+    // Queue a result, from any thread.
+    void push( Result && result );
+
+    // Wait on group, passing each result to consume on the calling thread
+    // as it arrives. Rethrows the first exception thrown by a task.
+    template < typename Consume >
+    void drain( TaskGroup & group, Consume const & consume );
+
+    private:
+    // Guards results.
+    std::mutex lock;
+    // Wakes the draining thread when results arrive.
+    std::condition_variable ready;
+    // The results not yet consumed.
+    std::vector< Result > results;
+  };
+
+  /*
+    Matches file names against one or more patterns separated by ';'. A
+    pattern containing '*', '?' or '[' is a glob matched byte-wise against
+    the whole file name. Any other pattern is a file extension the file name
+    must end with. The pattern ".*" matches every file.
+    Ex: FileFilter( ".txt;.png" ).matches( "img.png" ) -> true
+    Ex: FileFilter( "log_??.txt" ).matches( "log_01.txt" ) -> true
+    Ex: FileFilter( "*.[ch]" ).matches( "main.cpp" ) -> false
+  */
+  class FileFilter
+  {
+    public:
+    FileFilter( hst::hstring const & patterns = L".*" );
+
+    // Check if a file name (without its directory) matches the filter.
+    bool matches( std::string_view const & fileName ) const;
+
+    // Check if a glob pattern matches the whole of a file name.
+    static bool globMatches( std::string_view const & pattern,
+                             std::string_view const & fileName );
+
+    private:
+    // Set if any pattern matches every file.
+    bool matchesEverything = false;
+    // Patterns matched as file extensions.
+    std::vector< std::string > extensions;
+    // Patterns matched as globs.
+    std::vector< std::string > globs;
+  };
+
+  /*
+    Thrown when a cell of a file cannot be parsed as the type of its column.
+    The row and column are zero-based, and count rows and cells in the same
+    way as FIO::readFileToMatrix, skipping empty ones.
+  */
+  class ParseError : public std::runtime_error
+  {
+    public:
+    ParseError( std::string const & message,
+                std::size_t const & row,
+                std::size_t const & column,
+                std::string const & cell ) :
+      std::runtime_error( message ), errorRow( row ), errorColumn( column ),
+      errorCell( cell )
+    {
+    }
+
+    // The row of the cell which could not be parsed.
+    std::size_t row() const { return errorRow; }
+
+    // The column of the cell which could not be parsed.
+    std::size_t column() const { return errorColumn; }
+
+    // The unaltered text of the cell which could not be parsed.
+    std::string const & cell() const { return errorCell; }
+
+    private:
+    std::size_t errorRow;
+    std::size_t errorColumn;
+    std::string errorCell;
+  };
+
+  // The column types supported by runtime column schemas.
+  enum class ColumnType
+  {
+    Integer,
+    Real,
+    Text
+  };
+
+  // One column of a file loaded with a runtime column schema.
+  using Column = std::variant< std::vector< std::int64_t >,
+                               std::vector< double >,
+                               std::vector< std::string > >;
+
+  class IOStatsRecorder;
+
+  /*
+    An output file written in the background. Callers append into an
+    in-memory chunk, holding a mutex only while the bytes are copied; new
+    chunks are allocated outside of it. Full chunks are handed to a flusher
+    thread through a lock-free list, and the flusher writes them in large
+    batches with writev. Partly filled chunks are written once the writer
+    has been idle for FlushInterval. Callers only wait on the flusher when
+    more than maxPendingBytes are waiting to be written, or when they call
+    flush() or sync().
+    Ex: BufferedWriter( "/dir/log.txt" ).write( "foo\n" ).sync()
+  */
+  class BufferedWriter
+  {
+    public:
+    // The size of each in-memory chunk.
+    static std::size_t const constexpr ChunkCapacity = 256 * 1024;
+    // How long partly filled chunks are held before they are written.
+    static int const constexpr FlushIntervalMilliseconds = 50;
+
+    explicit BufferedWriter( hst::hstring const & pathToFile,
+                             bool const & appendToFile = OpenNewFile,
+                             std::size_t const & maxPendingBytes = 1 << 26 );
+    BufferedWriter( BufferedWriter const & ) = delete;
+    BufferedWriter & operator=( BufferedWriter const & ) = delete;
+    // Writes all remaining data and closes the file.
+    ~BufferedWriter();
+
+    // Append bytes to the file. Safe to call from several threads at once,
+    // and the bytes of one call are never interleaved with another's.
+    BufferedWriter & write( std::string_view const & data );
+
+    // Wait until everything appended so far has been written to the file.
+    BufferedWriter & flush();
+
+    // Wait until everything appended so far has reached the disk.
+    BufferedWriter & sync();
+
+    private:
+    // A block of appended bytes waiting to be written.
+    struct Chunk
+    {
+      // The next chunk in whichever list holds this one.
+      Chunk * next = nullptr;
+      // The order in which the chunk was handed to the flusher.
+      std::uint64_t sequence = 0;
+      // The number of bytes used.
+      std::size_t size = 0;
+      char data[ ChunkCapacity ];
+    };
+
+    // Hands the current chunk to the flusher. appendLock must be held.
+    void submitCurrentChunk();
+    // Moves the chunks the flusher has written to freeChunks. appendLock
+    // must be held.
+    void reclaimWrittenChunks();
+    // The main loop of the flusher thread.
+    void flushLoop();
+    // Writes a list of chunks to the file, in order.
+    void writeChunks( std::vector< Chunk * > const & chunks );
+    // Throws the error which stopped the flusher, if any.
+    void checkError() const;
+
+    friend class FIO;
+
+    // The target of the writer, for error messages and statistics.
+    hst::hstring path;
+    // Records each write as a writeLine on path, if FIO opened the writer.
+    IOStatsRecorder * statsRecorder = nullptr;
+    // The file being written to.
+#ifdef WINDOWS
+    HANDLE fileHandle = INVALID_HANDLE_VALUE;
+#else
+    int fileDescriptor = -1;
+#endif
+    // The most bytes allowed to wait for the flusher before callers block.
+    std::size_t maxPendingBytes;
+
+    // Guards currentChunk, freeChunks and submittedSequence.
+    std::mutex appendLock;
+    // The chunk being appended to, or nullptr.
+    Chunk * currentChunk = nullptr;
+    // Chunks which have been written or allocated, for reuse.
+    Chunk * freeChunks = nullptr;
+    // The number of chunks in freeChunks.
+    std::size_t freeChunkCount = 0;
+    // The sequence number of the last chunk handed to the flusher.
+    std::uint64_t submittedSequence = 0;
+    // Set while currentChunk holds bytes, which arms the flusher's timer.
+    std::atomic< bool > partialChunk { false };
+
+    // Chunks waiting to be written, newest first.
+    std::atomic< Chunk * > fullChunks { nullptr };
+    // Chunks written by the flusher, waiting to be reused.
+    std::atomic< Chunk * > writtenChunks { nullptr };
+    // The number of appended bytes which have not been written yet.
+    std::atomic< std::size_t > pendingBytes { 0 };
+    // The sequence number of the last chunk written.
+    std::atomic< std::uint64_t > writtenSequence { 0 };
+    // The error code of the first failed write, or 0.
+    std::atomic< int > writeError { 0 };
+
+    // Guards flusher wake-ups and waits for progress.
+    std::mutex flushLock;
+    // Wakes the flusher.
+    std::condition_variable wakeFlusher;
+    // Wakes callers waiting for the flusher.
+    std::condition_variable chunksWritten;
+    // Set when the writer is being destroyed.
+    bool stopping = false;
+    // The background thread writing chunks.
+    std::thread flusher;
+  };
+
+  // An open stream, and the mutex serializing operations on it.
+  template < typename Stream >
+  struct StreamEntry
+  {
+    template < typename... Args >
+    explicit StreamEntry( Args &&... args ) :
+      stream( std::forward< Args >( args )... )
+    {
+    }
+
+    // Held exclusively by stream operations, and shared by buffered writes,
+    // which the writer serializes itself.
+    std::shared_mutex lock;
+    // Set under lock once the stream is closed, so operations that found the
+    // entry before the close fail instead of using it.
+    bool closed = false;
+    Stream stream;
+  };
+
+  /*
+    A path interned by an FIO object, returned by FIO::getHandle. The stream
+    members of FIO taking a PathHandle go straight to the streams open on
+    the path, without resolving IDs or hashing the path. A handle refers to
+    the path its ID pointed to when the handle was made, and stays valid for
+    the lifetime of the FIO object, even across FIO::clear.
+    Ex: auto const data = fio.getHandle( "data" );
+      fio.openInputStream( "data" );
+      fio.readLine( data ) -> reads one line from "/dir/data/file.txt"
+  */
+  class PathHandle
+  {
+    public:
+    PathHandle() = default;
+
+    // Check if the handle refers to a path.
+    explicit operator bool() const { return slot != nullptr; }
+
+    // Check if two handles refer to the same interned path.
+    bool operator==( PathHandle const & other ) const
+    {
+      return slot == other.slot;
+    }
+    bool operator!=( PathHandle const & other ) const
+    {
+      return slot != other.slot;
+    }
+
+    // The path the handle refers to.
+    hst::hstring path() const;
+
+    private:
+    friend class FIO;
+    friend class PathTable;
+
+    // An interned path, and the streams open on it.
+    struct Slot;
+
+    explicit PathHandle( std::shared_ptr< Slot > slot ) :
+      slot( std::move( slot ) )
+    {
+    }
+
+    std::shared_ptr< Slot > slot;
+  };
+
+  struct PathHandle::Slot
+  {
+    explicit Slot( hst::hstring const & path ) : path( path ) {}
+
+    // The interned path.
+    hst::hstring const path;
+    // Serializes opening streams on the path. The stream members are read
+    // and replaced with std::atomic_load and std::atomic_store.
+    std::mutex lock;
+    // The input stream open on the path, or nullptr.
+    std::shared_ptr< StreamEntry< std::wifstream > > input;
+    // The output stream open on the path, or nullptr.
+    std::shared_ptr< StreamEntry< std::wofstream > > output;
+    // The buffered output stream open on the path, or nullptr.
+    std::shared_ptr< StreamEntry< BufferedWriter > > buffered;
+  };
+
+  /*
+    Interns paths for FIO. The table is split into shards, each with its own
+    lock, so threads working on different files never contend. A path is
+    freed once no handle refers to it and no stream is open on it, either
+    by release or by the sweeps made as a shard grows, so handles never go
+    stale and the table only holds the paths in use.
+    Ex: PathTable paths;
+      paths.intern( "/dir/file.txt" ) == paths.find( "/dir/file.txt" )
+  */
+  class PathTable
+  {
+    public:
+    // Find the handle of an interned path, or an empty handle.
+    PathHandle find( hst::hstring const & path ) const;
+
+    // Find the handle of a path, interning the path if needed.
+    PathHandle intern( hst::hstring const & path );
+
+    // Free a path if it is no longer in use.
+    void release( hst::hstring const & path );
+
+    // Free every path no longer in use.
+    void prune();
+
+    // The handles of every interned path.
+    std::vector< PathHandle > handles() const;
+
+    // The number of interned paths.
+    std::size_t size() const;
+
+    private:
+    // The number of independently locked parts of the table.
+    static std::size_t const constexpr ShardCount = 16;
+    // The least number of paths a shard holds before it is swept.
+    static std::size_t const constexpr MinSweepSize = 64;
+
+    // One independently locked part of the table.
+    struct Shard
+    {
+      std::mutex lock;
+      std::unordered_map< std::wstring, std::shared_ptr< PathHandle::Slot > >
+        slots;
+      // The number of paths at which the shard is next swept.
+      std::size_t sweepSize = MinSweepSize;
+    };
+
+    // The shard a path belongs to.
+    Shard & shardOf( std::wstring const & path ) const;
+    // Check if only the table refers to a slot, and no stream is open on it.
+    // The shard lock must be held, so no new handle can be made meanwhile.
+    static bool isUnused( std::shared_ptr< PathHandle::Slot > const & slot );
+    // Free the unused paths of a locked shard.
+    static void sweep( Shard & shard );
+
+    mutable std::array< Shard, ShardCount > shards;
+  };
+
+  // Receives the path of each file found by FIO::findFiles.
+  using FileCallback = std::function< void( hst::hstring const & ) >;
+
+  // The outcome of reading one file with FIO::readFiles.
+  struct FileContents
+  {
+    // The path or ID the file was read from.
+    hst::hstring path;
+    // The unaltered contents of the file, if it could be read.
+    hst::hstring contents;
+    // The exception thrown while reading the file, or nullptr.
+    std::exception_ptr error;
+
+    // Check if the file was read.
+    explicit operator bool() const { return ! error; }
+  };
+
+  // Receives each file read by FIO::readFiles.
+  using FileContentsCallback = std::function< void( FileContents && ) >;
+
+  // The default number of files FIO::readFiles reads at once.
+  std::size_t const constexpr DefaultReadsInFlight = 16;
+
+  // Directory index change tracking mode.
+  bool const constexpr WatchChangesTrue = true;
+  // Directory index snapshot mode.
+  bool const constexpr WatchChangesFalse = false;
+
+  /*
+    An in-memory snapshot of a directory tree, holding the name, size and
+    modification time of every regular file in it. Answers the same queries
+    as FIO::findFiles without touching the disk. On Linux the snapshot is
+    kept current with inotify, falling back to a full rescan when the kernel
+    drops change notifications. An index whose directories cannot all be
+    watched throws when it is made, and is marked degraded if a directory
+    added later cannot be watched. Elsewhere, rescan brings it up to date.
+    Symbolic links to files are indexed, but linked directories are not
+    followed. An index can be saved to a binary file and loaded again, in
+    which case only directories changed since the save are re-read.
+    Ex: DirectoryIndex( "/dir" ).findFiles( ".txt" ) -> a vector of .txt
+      filenames in or below /dir.
+  */
+  class DirectoryIndex
+  {
+    public:
+    // A regular file in the snapshot.
+    struct File
+    {
+      std::string name;
+      std::uint64_t size = 0;
+      // The modification time, in nanoseconds since the epoch.
+      std::int64_t modified = 0;
+    };
+
+    // A directory in the snapshot, and the files directly inside it.
+    struct Directory
+    {
+      // The modification time, in nanoseconds since the epoch.
+      std::int64_t modified = 0;
+      std::vector< File > files;
+    };
+
+    explicit DirectoryIndex( hst::hstring const & rootDirectory,
+                             bool const & watchChanges = WatchChangesTrue );
+    DirectoryIndex( DirectoryIndex const & ) = delete;
+    DirectoryIndex & operator=( DirectoryIndex const & ) = delete;
+    ~DirectoryIndex();
 
     /*
-      Check if an input stream is currently opened on the source pointed to by
-      pathOrID. If pathOrID is a stored ID, the ID's target will be used to
-      check for the target stream, otherwise pathOrID will be used to check for
-      the target stream.
-      Ex: Path Map contains [ { "data", "/dir/data/file.txt" } ]
-        hasInputStream( "data" ) -> checks if there is an input stream stored
-        under"/dir/data/file.txt"
+      Load an index saved with save. Directories whose modification time
+      changed since the save are re-read, which picks up added, removed and
+      renamed entries. Files modified in place while the index was not loaded
+      keep their saved size and time until the next rescan.
+      Ex: DirectoryIndex::load( "/dir/index.bin" )->findFiles( ".txt" )
     */
-    bool hasInputStream( hst::hstring const & pathOrID );
+    static std::unique_ptr< DirectoryIndex > load(
+      hst::hstring const & pathToFile,
+      bool const & watchChanges = WatchChangesTrue );
+
+    // Save the snapshot to a binary file, for use with load.
+    void save( hst::hstring const & pathToFile ) const;
+
+    // Find files in the snapshot, as FIO::findFiles does on the disk.
+    std::vector< hst::hstring > findFiles(
+      hst::hstring const & fileExtension = L".*",
+      bool const & recursiveSearch = RecursiveSearchTrue ) const;
+
+    // Find files in the snapshot, passing each one to onFileFound. Returns
+    // the number of files found.
+    std::size_t findFiles(
+      FileCallback const & onFileFound,
+      hst::hstring const & fileExtension = L".*",
+      bool const & recursiveSearch = RecursiveSearchTrue ) const;
+
+    // Read the whole tree again.
+    DirectoryIndex & rescan();
+
+    // Find a file in the snapshot by its full path.
+    std::optional< File > findFile( hst::hstring const & pathToFile ) const;
+
+    // The number of files in the snapshot.
+    std::size_t fileCount() const;
+
+    // Check if a directory of the snapshot could not be watched, so that its
+    // changes are missed until the next rescan.
+    bool degraded() const { return watchError.load() != 0; }
+
+    // The directory the snapshot starts at.
+    hst::hstring rootDirectory() const { return root; }
+
+    private:
+    // Selects the constructor which leaves the snapshot empty.
+    struct EmptySnapshot
+    {
+    };
+
+    // The directories of a snapshot, and the watches keeping it current.
+    struct Tree
+    {
+      // The directories of the tree, keyed by their path relative to root.
+      // The root itself has the empty key.
+      std::map< std::string, Directory > directories;
+#ifndef WINDOWS
+      // The directories reached through symbolic links, by device and inode,
+      // and the directory of the tree each one is followed at.
+      std::map< std::pair< dev_t, ino_t >, std::string > linkedDirectories;
+#endif
+#ifdef __linux__
+      // The watched directories, by watch descriptor. Linked directories
+      // share the watch of their target.
+      std::unordered_multimap< int, std::string > watchedDirectories;
+      // The watch descriptors, by watched directory.
+      std::unordered_map< std::string, int > watchDescriptors;
+#endif
+    };
+
+    DirectoryIndex( hst::hstring const & rootDirectory,
+                    bool const & watchChanges,
+                    EmptySnapshot );
+
+    // Reads a directory and everything below it into a tree.
+    void scanTree( std::string const & directory, Tree & into );
+    // Reads the whole tree into a new snapshot without holding the lock, and
+    // then swaps it in. updateLock must be held.
+    void replaceTree();
+    // Throws if a directory of the snapshot could not be watched.
+    void checkWatched() const;
+    // Reads the files of one directory again, scanning new sub-directories
+    // and removing deleted ones.
+    void rescanDirectory( std::string const & directory );
+    // Removes a directory and everything below it from the snapshot.
+    void removeTree( std::string const & directory );
+    // Lists the files and sub-directories of a directory on the disk,
+    // following linked directories not yet followed elsewhere in the tree.
+    // Returns false if the directory cannot be read.
+    bool readDirectory( std::string const & directory,
+                        Directory & contents,
+                        std::vector< std::string > & subdirectories,
+                        Tree & into );
+    // The full path of a directory in the snapshot.
+    std::string fullPath( std::string const & directory ) const;
+    // The path of an entry of a directory.
+    static std::string childPath( std::string const & directory,
+                                  std::string const & name );
+    // Reads the modification time of a directory on the disk. Returns false
+    // if it is not a directory.
+    static bool directoryModified( std::string const & path,
+                                   std::int64_t & modified );
+#ifdef WINDOWS
+    // Converts a file time to nanoseconds since the epoch.
+    static std::int64_t modifiedTime( FILETIME const & time );
+#else
+    // The modification time of a file, in nanoseconds since the epoch.
+    static std::int64_t modifiedTime( struct stat const & info );
+    // Checks if a linked directory should be followed at directory. Each
+    // linked directory is only followed once, as FIO::findFiles does, so
+    // cycles terminate.
+    static bool followLink( std::string const & directory,
+                            struct stat const & info,
+                            Tree & into );
+    // Forgets the linked directories followed at or below directory.
+    static void releaseLinks( std::string const & directory, Tree & from );
+#endif
+
+#ifdef __linux__
+    // Updates the snapshot for one changed entry of a directory.
+    void updateEntry( std::string const & directory, std::string const & name );
+    // Starts watching a directory of a tree for changes, if changes are
+    // watched. Returns the error which kept the directory from being
+    // watched, or 0.
+    int watchDirectory( std::string const & directory, Tree & into );
+    // Stops watching a directory of a tree.
+    void unwatchDirectory( std::string const & directory, Tree & from );
+    // Starts the watcher thread, if changes are watched.
+    void startWatching();
+    // The main loop of the watcher thread.
+    void watchLoop();
+#endif
+
+#ifdef WINDOWS
+    static char const constexpr Separator = '\\';
+#else
+    static char const constexpr Separator = '/';
+#endif
+
+    // Identifies files saved by save, and their format version.
+    static char const constexpr IndexMagic[ 8 ] = {
+      'F', 'I', 'O', 'I', 'D', 'X', '0', '1' };
+
+    // The directory the snapshot starts at.
+    std::string root;
+    // Guards the snapshot.
+    mutable std::shared_mutex lock;
+    // Serializes changes to the snapshot, so that a full rescan reading the
+    // disk without the lock never loses the updates made meanwhile.
+    std::mutex updateLock;
+    // The snapshot.
+    Tree tree;
+    // The error of the first directory which could not be watched, or 0.
+    std::atomic< int > watchError { 0 };
+
+#ifdef __linux__
+    // The inotify instance, or -1 if changes are not watched.
+    int inotifyDescriptor = -1;
+    // Wakes the watcher thread to stop it.
+    int stopDescriptor = -1;
+    // The thread applying change notifications.
+    std::thread watcher;
+#endif
+  };
+
+  // The operations FIO records statistics for.
+  enum class IOOperation
+  {
+    ReadLine,
+    WriteLine,
+    ReadFile,
+    Open,
+    Close,
+    FindFiles
+  };
+
+  // The number of IOOperation values.
+  std::size_t const constexpr IOOperationCount = 6;
+
+  // The name of an operation, as used in statistics dumps.
+  static char const * operationName( IOOperation const & operation );
+
+  // Quote and escape a string for use in JSON.
+  static std::string quoteJSON( std::string_view const & str );
+
+  /*
+    A histogram of operation latencies. Each bucket is twice as wide as the
+    one before it, so percentiles are exact to within a factor of two.
+    Ex: histogram.record( 1500 ) -> counted in the bucket [ 1024, 2048 )
+  */
+  struct LatencyHistogram
+  {
+    // The number of buckets, enough for any 64 bit nanosecond count.
+    static std::size_t const constexpr BucketCount = 65;
+
+    // Add one latency.
+    void record( std::uint64_t const & nanoseconds );
+    // Add the latencies recorded by another histogram.
+    void merge( LatencyHistogram const & other );
+    // The upper bound of the bucket holding the given percentile, in ns.
+    std::uint64_t percentile( double const & percent ) const;
+
+    // The number of latencies recorded.
+    std::uint64_t count = 0;
+    // The sum of the latencies recorded, in ns.
+    std::uint64_t totalNanoseconds = 0;
+    // Bucket i counts latencies in [ 2^(i-1), 2^i ) ns, bucket 0 counts 0 ns.
+    std::array< std::uint64_t, BucketCount > buckets{};
+  };
+
+  /*
+    The I/O done on one path. Bytes moved through the wide streams are
+    counted in characters, as only the stream knows their encoded size.
+  */
+  struct PathStats
+  {
+    // Add the counts of another PathStats.
+    void merge( PathStats const & other );
+
+    // The Path Map IDs pointing to the path when the snapshot was taken.
+    std::vector< std::string > IDs;
+    std::uint64_t bytesRead = 0;
+    std::uint64_t bytesWritten = 0;
+    std::uint64_t readLineCalls = 0;
+    // Includes the writes of buffered output streams.
+    std::uint64_t writeLineCalls = 0;
+    // Includes every whole file read, each file of readFiles, and readRecords,
+    // whose lazily read bytes are not counted.
+    std::uint64_t readFileCalls = 0;
+    std::uint64_t opens = 0;
+    std::uint64_t closes = 0;
+    std::uint64_t findFilesCalls = 0;
+    // The directories read by findFiles calls searching from the path.
+    std::uint64_t directoriesVisited = 0;
+    // The directory entries findFiles had to stat to learn their type.
+    std::uint64_t entriesStatted = 0;
+  };
+
+  /*
+    A snapshot of the I/O statistics of an FIO object, returned by
+    FIO::stats. Statistics are only recorded when FIO_ENABLE_STATS is
+    defined and recording has been turned on with FIO::enableStats.
+    Ex: fio.enableStats(); fio.readFile( "data" );
+      fio.stats().paths[ "/dir/data/file.txt" ].readFileCalls -> 1
+  */
+  struct IOStats
+  {
+    // The latencies of one operation.
+    LatencyHistogram const & latency( IOOperation const & operation ) const;
+    // The statistics as a JSON object.
+    std::string toJSON() const;
+    // The statistics as a human readable table.
+    std::string toText() const;
+
+    // Whether statistics were being recorded when the snapshot was taken.
+    bool enabled = false;
+    // The I/O done on each path, by path.
+    std::map< std::string, PathStats > paths;
+    // The latencies of each operation, indexed by IOOperation.
+    std::array< LatencyHistogram, IOOperationCount > latencies;
+  };
+
+#ifdef FIO_ENABLE_STATS
+  /*
+    Records the I/O statistics of an FIO object. Each thread records into its
+    own block, so recording never contends with other threads, and only
+    snapshots and resets visit every block. The blocks of exited threads are
+    folded into one, so their work is kept without keeping their blocks.
+  */
+  class IOStatsRecorder
+  {
+    using Clock = std::chrono::steady_clock;
+
+    public:
+    /*
+      Records one operation on a path when it goes out of scope, if
+      recording was turned on when the operation started. The path is only
+      converted to its multi-byte key when the operation is recorded.
+    */
+    class Scope
+    {
+      public:
+      Scope( IOStatsRecorder & recorder,
+             hst::hstring const & path,
+             IOOperation const & operation );
+      // The path is kept by reference, so it must outlive the scope.
+      Scope( IOStatsRecorder &, hst::hstring &&, IOOperation const & ) = delete;
+      Scope( Scope const & ) = delete;
+      Scope & operator=( Scope const & ) = delete;
+      ~Scope();
+
+      void addBytesRead( std::uint64_t const & bytes ) { bytesRead += bytes; }
+      void addBytesWritten( std::uint64_t const & bytes )
+      {
+        bytesWritten += bytes;
+      }
+      void addDirectoriesVisited( std::uint64_t const & directories )
+      {
+        directoriesVisited += directories;
+      }
+      void addEntriesStatted( std::uint64_t const & entries )
+      {
+        entriesStatted += entries;
+      }
+
+      private:
+      // The recorder to record into, or nullptr if recording is off.
+      IOStatsRecorder * const recorder;
+      hst::hstring const & path;
+      IOOperation const operation;
+      Clock::time_point start;
+      std::uint64_t bytesRead = 0;
+      std::uint64_t bytesWritten = 0;
+      std::uint64_t directoriesVisited = 0;
+      std::uint64_t entriesStatted = 0;
+    };
+
+    IOStatsRecorder();
+    IOStatsRecorder( IOStatsRecorder const & ) = delete;
+    IOStatsRecorder & operator=( IOStatsRecorder const & ) = delete;
+    // Frees the statistics held in the blocks of threads still running.
+    ~IOStatsRecorder();
+
+    // Turn recording on or off.
+    void enable( bool const & enable );
+    // Check if recording is on.
+    bool enabled() const { return recording.load( std::memory_order_relaxed ); }
+    // The statistics recorded by every thread so far.
+    IOStats snapshot() const;
+    // Discard the statistics recorded so far.
+    void reset();
+
+    private:
+    // The statistics recorded by one thread.
+    struct ThreadBlock
+    {
+      // Only contended while a snapshot or reset visits the block.
+      std::mutex lock;
+      std::unordered_map< std::string, PathStats > paths;
+      std::array< LatencyHistogram, IOOperationCount > latencies;
+      // Set once the recorder is destroyed, so the thread drops the block.
+      std::atomic< bool > orphaned { false };
+    };
+
+    // The least number of blocks before exited threads are looked for.
+    static std::size_t const constexpr MinPruneSize = 16;
+
+    // The calling thread's block, created on first use.
+    ThreadBlock & threadBlock();
+    // Folds the blocks of exited threads into exitedThreads. blocksLock must
+    // be held.
+    void pruneBlocks();
+    // Adds the statistics of a block to a snapshot. The block's lock must be
+    // held.
+    static void mergeBlock( IOStats & stats, ThreadBlock const & block );
+    // A recorder ID unique within the process.
+    static std::uint64_t newRecorderID();
+
+    // Whether operations are being recorded.
+    std::atomic< bool > recording{ false };
+    // Tells this recorder's blocks apart in each thread's block list.
+    std::uint64_t const recorderID;
+    // Guards blocks, exitedThreads and pruneSize.
+    mutable std::mutex blocksLock;
+    // The blocks of the running threads which have recorded an operation.
+    // Each is shared with its thread, so a block only held here belongs to a
+    // thread which has exited.
+    std::vector< std::shared_ptr< ThreadBlock > > blocks;
+    // The statistics recorded by threads which have exited.
+    IOStats exitedThreads;
+    // The number of blocks at which exited threads are next looked for.
+    std::size_t pruneSize = MinPruneSize;
+  };
+#else
+  // Statistics are compiled out, so recording them costs nothing.
+  class IOStatsRecorder
+  {
+    public:
+    class Scope
+    {
+      public:
+      Scope( IOStatsRecorder &, hst::hstring const &, IOOperation const & ) {}
+      Scope( IOStatsRecorder &, hst::hstring &&, IOOperation const & ) = delete;
+
+      void addBytesRead( std::uint64_t const & ) {}
+      void addBytesWritten( std::uint64_t const & ) {}
+      void addDirectoriesVisited( std::uint64_t const & ) {}
+      void addEntriesStatted( std::uint64_t const & ) {}
+    };
+
+    void enable( bool const & ) {}
+    bool enabled() const { return false; }
+    IOStats snapshot() const { return IOStats(); }
+    void reset() {}
+  };
+#endif
+
+  /*
+    Simplifies filesystem interaction for applications. One FIO object may be
+    used by several threads at once. Path IDs are looked up in an immutable
+    snapshot without locking, and threads using streams on different files
+    never contend. Stream members check and use a stream under one lock, so
+    a call racing with closeInputStream or closeOutputStream either finishes
+    before the stream is closed or throws. The stream references returned
+    by the open and get members are not guarded, and stay valid until the
+    stream is closed.
+  */
+  class FIO
+  {
+    public:
+    /*
+      Construct an FIO object using a given locale for string conversions. The
+      default locale is the user environment's locale.
+    */
+    FIO( hst::hstring const & loc = "" );
+    FIO( FIO const & ) = delete;
+    FIO & operator=( FIO const & ) = delete;
+    ~FIO() = default;
+
+    /*
+      Clear FIO to its initial state. Safely closes all filestreams, and clears
+      all internal mappings.
+    */
+    FIO & clear();
+
+    /*
+      Intern the filepath pointed to by pathOrID, returning a handle to it. If
+      pathOrID is a stored ID, the ID's target will be interned, otherwise
+      pathOrID will be interned. The stream members taking a handle skip ID
+      lookups and path hashing, which suits calling them once per line.
+      Ex: Path Map contains [ { "data", "/dir/data/file.txt" } ]
+        getHandle( "data" ) -> handle to filepath "/dir/data/file.txt"
+    */
+    PathHandle getHandle( hst::hstring const & pathOrID );
+
+    /*
+      Open a wide input stream on the filepath pointed to by pathOrID. If
+      pathOrID is a stored ID, the ID's target will be used as the stream
+      source, otherwise pathOrID will be used as the stream source.
+      Ex: Path Map contains [ { "data", "/dir/data/file.txt" } ]
+        openInputStream( "data" ) -> reads from filepath "/dir/data/file.txt"
+        openInputStream( "/dir/data/file.txt" ) ->
+          reads from filepath "/dir/data/file.txt"
+      openInputStream( "/dir/data/desc/spawnpoints.txt" ->
+        reads from filepath "/dir/data/desc/spawnpoints.txt" )
+    */
+    std::wistream & openInputStream( hst::hstring const & pathOrID );
+
+    /*
+      Open a wide output stream on the filepath pointed to by pathOrID. If
+      pathOrID is a stored ID, the ID's target will be used as the stream
+      target, otherwise pathOrID will be used as the stream target.
+      Optionally, the new wide output stream can be opened in append mode.
+      Throws if a buffered output stream is open on the filepath.
+      Ex: Path Map contains [ { "data", "/dir/data/file.txt" } ]
+        openOutputStream( "data" ) -> writes to filepath "/dir/data/file.txt"
+        openOutputStream( "/dir/data/file.txt" ) ->
+          writes to filepath "/dir/data/file.txt"
+        openOutputStream( "/dir/data/desc/spawnpoints.txt" ->
+          writes to filepath "/dir/data/desc/spawnpoints.txt" )
+    */
+    std::wostream & openOutputStream( hst::hstring const & pathOrID,
+                                      bool const & appendToFile = OpenNewFile );
+
+    /*
+      Open a buffered output stream on the filepath pointed to by pathOrID.
+      Writes are collected in memory and written by a background thread, so
+      writeLine returns without waiting for the disk. Text is written in the
+      multi-byte encoding of the current locale. An open buffered stream is
+      used by writeLine, flushOutputStream, syncOutputStream,
+      hasOutputStream and closeOutputStream just like a wide output stream,
+      and retrieved with getBufferedOutputStream. Throws if a wide output
+      stream is open on the filepath.
+      Ex: Path Map contains [ { "log", "/dir/data/log.txt" } ]
+        openBufferedOutputStream( "log" ) -> writes to filepath
+          "/dir/data/log.txt" in the background
+    */
+    BufferedWriter & openBufferedOutputStream(
+      hst::hstring const & pathOrID, bool const & appendToFile = OpenNewFile );
+
+    /*
+      Rewind a previously opened input stream pointed to by pathOrID. If
+      pathOrID is a stored ID, the ID's target will be used as the rewind
+      target, otherwise pathOrID will be used as the rewind target.
+      Ex: Path Map contains [ { "data", "/dir/data/file.txt" } ]
+        rewindInputStream( "data" ) -> rewinds the input stream stored
+          under"/dir/data/file.txt"
+    */
+    std::wistream & rewindInputStream( hst::hstring const & streamID );
+
+    /*
+      Close a previously opened input stream pointed to by pathOrID. If
+      pathOrID is a stored ID, the ID's target will be used to close the
+      target stream, otherwise pathOrID will be used to close the target
+      stream.
+      Ex: Path Map contains [ { "data", "/dir/data/file.txt" } ]
+        closeInputStream( "data" ) -> closes the input stream stored
+          under"/dir/data/file.txt"
+    */
+    FIO & closeInputStream( hst::hstring const & pathOrID );
+
+    /*
+      Close a previously opened output stream pointed to by pathOrID. If
+      pathOrID is a stored ID, the ID's target will be used to close the
+      target stream, otherwise pathOrID will be used to close the target
+      stream.
+      Ex: Path Map contains [ { "data", "/dir/data/file.txt" } ]
+        closeOutputStream( "data" ) -> closes the output stream stored
+          under"/dir/data/file.txt"
+    */
+    FIO & closeOutputStream( hst::hstring const & pathOrID );
+
+    /*
+      Write out everything previously written to the output stream pointed to
+      by pathOrID. If pathOrID is a stored ID, the ID's target will be used to
+      flush the target stream, otherwise pathOrID will be used to flush the
+      target stream.
+      Ex: Path Map contains [ { "data", "/dir/data/file.txt" } ]
+        flushOutputStream( "data" ) -> writes out the output stream stored
+          under"/dir/data/file.txt"
+    */
+    FIO & flushOutputStream( hst::hstring const & pathOrID );
+
+    /*
+      Flush the output stream pointed to by pathOrID, and wait until its
+      contents have reached the disk. Wide output streams are only flushed.
+      Ex: Path Map contains [ { "data", "/dir/data/file.txt" } ]
+        syncOutputStream( "data" ) -> commits the output stream stored
+          under"/dir/data/file.txt" to disk
+    */
+    FIO & syncOutputStream( hst::hstring const & pathOrID );
+
+    /*
+      Check if an input stream is currently opened on the source pointed to by
+      pathOrID. If pathOrID is a stored ID, the ID's target will be used to
+      check for the target stream, otherwise pathOrID will be used to check for
+      the target stream.
+      Ex: Path Map contains [ { "data", "/dir/data/file.txt" } ]
+        hasInputStream( "data" ) -> checks if there is an input stream stored
+        under"/dir/data/file.txt"
+    */
+    bool hasInputStream( hst::hstring const & pathOrID );
+
+    /*
+      Check if an output stream is currently opened on the source pointed to by
+      pathOrID. If pathOrID is a stored ID, the ID's target will be used to
+      check for the target stream, otherwise pathOrID will be used to check for
+      the target stream.
+      Ex: Path Map contains [ { "data", "/dir/data/file.txt" } ]
+        hasOutputStream( "data" ) -> checks if there is an output stream stored
+          under"/dir/data/file.txt"
+    */
+    bool hasOutputStream( hst::hstring const & pathOrID );
+
+    /*
+      Retrieve a previously opened input stream pointed to by pathOrID. If
+      pathOrID is a stored ID, the ID's target will be used to retrieve the
+      target stream, otherwise pathOrID will be used to retrieve the target
+      stream.
+      Ex: Path Map contains [ { "data", "/dir/data/file.txt" } ]
+        getInputStream( "data" ) -> retrieves the input stream stored
+          under"/dir/data/file.txt"
+    */
+    std::wistream & getInputStream( hst::hstring const & pathOrID ) const;
+
+    /*
+      Retrieve a previously opened output stream pointed to by pathOrID. If
+      pathOrID is a stored ID, the ID's target will be used to retrieve the
+      target stream, otherwise pathOrID will be used to retrieve the target
+      stream.
+      Ex: Path Map contains [ { "data", "/dir/data/file.txt" } ]
+        getOutputStream( "data" ) -> retrieves the output stream stored
+          under"/dir/data/file.txt"
+    */
+    std::wostream & getOutputStream( hst::hstring const & pathOrID ) const;
+
+    /*
+      Retrieve a previously opened buffered output stream pointed to by
+      pathOrID, in the same way as getOutputStream.
+      Ex: Path Map contains [ { "log", "/dir/data/log.txt" } ]
+        getBufferedOutputStream( "log" ) -> retrieves the buffered output
+          stream stored under "/dir/data/log.txt"
+    */
+    BufferedWriter & getBufferedOutputStream(
+      hst::hstring const & pathOrID ) const;
+
+    /*
+      Read one unaltered line from a previously opened input stream pointed
+      to by pathOrID. If pathOrID is a stored ID, the ID's target will be used
+      to read from the target stream, otherwise pathOrID will be used to
+      read from the target stream.
+      Ex: Path Map contains [ { "data", "/dir/data/file.txt" } ]
+        readLine( "data" ) -> reads one line from the input stream stored
+          under"/dir/data/file.txt"
+    */
+    hst::hstring readLine( hst::hstring const & pathOrID );
+
+    /*
+      Write one unaltered line to a previously opened output stream pointed
+      to by pathOrID. If pathOrID is a stored ID, the ID's target will be used
+      to write to the target stream, otherwise pathOrID will be used to
+      write to the target stream.
+      Ex: Path Map contains [ { "data", "/dir/data/file.txt" } ]
+        writeLine( "data", "foo\n" ) -> writes "foo\n" to the output stream
+          stored under"/dir/data/file.txt"
+    */
+    FIO & writeLine( hst::hstring const & pathOrID,
+                     hst::hstring const & source );
+
+    /*
+      The stream members above, acting on the filepath of a handle returned
+      by getHandle instead of a pathOrID. Streams opened either way are
+      shared, so a stream opened with a pathOrID can be used through a
+      handle to the same filepath.
+      Ex: Path Map contains [ { "data", "/dir/data/file.txt" } ]
+        writeLine( getHandle( "data" ), "foo\n" ) -> writes "foo\n" to the
+          output stream stored under "/dir/data/file.txt"
+    */
+    std::wistream & openInputStream( PathHandle const & handle );
+    std::wostream & openOutputStream( PathHandle const & handle,
+                                      bool const & appendToFile = OpenNewFile );
+    BufferedWriter & openBufferedOutputStream(
+      PathHandle const & handle, bool const & appendToFile = OpenNewFile );
+    std::wistream & rewindInputStream( PathHandle const & handle );
+    FIO & closeInputStream( PathHandle const & handle );
+    FIO & closeOutputStream( PathHandle const & handle );
+    FIO & flushOutputStream( PathHandle const & handle );
+    FIO & syncOutputStream( PathHandle const & handle );
+    bool hasInputStream( PathHandle const & handle );
+    bool hasOutputStream( PathHandle const & handle );
+    std::wistream & getInputStream( PathHandle const & handle ) const;
+    std::wostream & getOutputStream( PathHandle const & handle ) const;
+    BufferedWriter & getBufferedOutputStream(
+      PathHandle const & handle ) const;
+    hst::hstring readLine( PathHandle const & handle );
+    FIO & writeLine( PathHandle const & handle, hst::hstring const & source );
+
+    /*
+      Finds all regular files matching a given file extension starting at a
+      directory pointed to by pathOrID. If pathOrID is a stored ID, the ID's
+      target will be used to find the files, otherwise pathOrID
+      will be used to write to find the files. Optionally recursively
+      searches through sub-directories, which are searched in parallel on
+      the shared TaskPool. The file extension may also be a list of
+      extensions and globs, as accepted by FileFilter. Files are returned in
+      no particular order.
+      Ex: findFiles( ".txt", "/dir", RecursiveSearchTrue ) -> a vector of .txt
+        filenames in or below /dir.
+      Ex: findFiles( ".png", "/dir", RecursiveSearchFalse ) -> a vector of .png
+        filenames only within /dir.
+      Ex: findFiles( ".png;*.jp*g" ) -> a vector of .png, .jpg and .jpeg
+        filenames in or below the root directory.
+    */
+    std::vector< hst::hstring > findFiles(
+      hst::hstring const & fileExtension = L".*",
+      hst::hstring const & pathOrID = L"__root",
+      bool const & recursiveSearch = RecursiveSearchTrue ) const;
+
+    /*
+      Finds files in the same way as findFiles, but passes each file to
+      onFileFound as soon as its directory has been read, instead of
+      collecting them. onFileFound is called on the calling thread, while
+      the search goes on in the background, and may itself search or read
+      files. Returns the number of files found.
+      Ex: findFiles( []( hst::hstring const & f ) { load( f ); }, ".json" )
+    */
+    std::size_t findFiles(
+      FileCallback const & onFileFound,
+      hst::hstring const & fileExtension = L".*",
+      hst::hstring const & pathOrID = L"__root",
+      bool const & recursiveSearch = RecursiveSearchTrue ) const;
+
+    /*
+      Build a DirectoryIndex of the directory pointed to by pathOrID. Later
+      findFiles calls on the same directory are answered from the index
+      instead of the disk. If pathOrID is a stored ID, the ID's target will be
+      indexed, otherwise pathOrID will be indexed. Optionally, the index can
+      be left unwatched, so that it only changes through rescan.
+      Ex: Path Map contains [ { "data", "/dir/data" } ]
+        indexDirectory( "data" ) -> findFiles( ".txt", "data" ) reads the
+          index of "/dir/data"
+    */
+    DirectoryIndex & indexDirectory(
+      hst::hstring const & pathOrID,
+      bool const & watchChanges = WatchChangesTrue );
+
+    /*
+      Load a DirectoryIndex saved with DirectoryIndex::save, and use it for
+      the directory pointed to by pathOrID as indexDirectory does. The index
+      must have been saved from the same directory.
+      Ex: loadDirectoryIndex( "data", "/dir/data.index" )
+    */
+    DirectoryIndex & loadDirectoryIndex(
+      hst::hstring const & pathOrID,
+      hst::hstring const & pathToIndex,
+      bool const & watchChanges = WatchChangesTrue );
+
+    // Stop using an index for the directory pointed to by pathOrID.
+    FIO & removeDirectoryIndex( hst::hstring const & pathOrID );
+
+    /*
+      Read the unaltered contents of a file pointed
+      to by pathOrID. If pathOrID is a stored ID, the ID's target will be used
+      as the target filepath, otherwise pathOrID will be used as the target
+      filepath. There does not need to be an open stream on the filepath. Will
+      reset an open filestream to its filestart before reading.
+      Ex: Path Map contains [ { "data", "/dir/data/file.txt" } ]
+        readFile( "data" ) -> reads the contents of "/dir/data/file.txt"
+    */
+    hst::hstring readFile( hst::hstring const & pathOrID );
+
+    /*
+      Read the unaltered contents of many files at once, on the shared
+      TaskPool. At most maxInFlight files are read at the same time, and no
+      more than the pool has threads, plus one read on the calling thread.
+      Each entry of pathsOrIDs is used as readFile would use it. Files which
+      cannot be read are reported through the error of their result instead
+      of an exception, and the results are in the order of pathsOrIDs.
+      Ex: readFiles( { "data", "/dir/other.txt" } ) -> the contents of
+        "/dir/data/file.txt" and "/dir/other.txt"
+    */
+    std::vector< FileContents > readFiles(
+      std::vector< hst::hstring > const & pathsOrIDs,
+      std::size_t const & maxInFlight = DefaultReadsInFlight );
+
+    /*
+      Reads files in the same way as readFiles, but passes each file to
+      onFileRead as soon as it has been read, instead of collecting them.
+      onFileRead is called on the calling thread, while the other files are
+      read in the background, and may itself read or search files. Returns
+      the number of files read without errors.
+      Ex: readFiles( []( FileContents && f ) { parse( f.contents ); }, paths )
+    */
+    std::size_t readFiles(
+      FileContentsCallback const & onFileRead,
+      std::vector< hst::hstring > const & pathsOrIDs,
+      std::size_t const & maxInFlight = DefaultReadsInFlight );
+
+    /*
+      Read every file findFiles finds for the same arguments, in the same
+      way as readFiles.
+      Ex: readFiles( ".json", "data" ) -> the contents of every .json file in
+        or below "/dir/data"
+    */
+    std::vector< FileContents > readFiles(
+      hst::hstring const & fileExtension,
+      hst::hstring const & pathOrID,
+      bool const & recursiveSearch = RecursiveSearchTrue,
+      std::size_t const & maxInFlight = DefaultReadsInFlight );
+
+    /*
+      Read the contents of a file pointed to by pathOrID as a vector split on
+      all provided delimiting characters. If pathOrID is a stored ID, the ID's
+      target will be used as the target filepath, otherwise pathOrID will be
+      used as the target filepath. There does not need to be an open stream on
+      the filepath. Will reset an open filestream to its filestart before
+      reading.
+      Ex: Path Map contains [ { "data", "/dir/data/file.txt" } ]
+        readFileToVector( "data", "\n\r" ) -> reads the contents of
+        "/dir/data/file.txt", split on the '\n' and '\r' characters.
+    */
+    std::vector< hst::hstring > readFileToVector(
+      hst::hstring const & pathOrID, hst::hstring const & delim = L"\n\r" );
+
+    /*
+      Read the file pointed to by pathOrID one record at a time, split on all
+      provided delimiting characters, in constant memory. If pathOrID is a
+      stored ID, the ID's target will be used as the target filepath,
+      otherwise pathOrID will be used as the target filepath. The delimiters
+      must be ASCII characters. Will reset an open filestream to its
+      filestart before reading.
+      Ex: Path Map contains [ { "data", "/dir/data/file.txt" } ]
+        for ( auto line : readRecords( "data" ) ) -> each line of
+          "/dir/data/file.txt", without reading the whole file at once
+    */
+    RecordReader readRecords( hst::hstring const & pathOrID,
+                              hst::hstring const & delim = L"\n\r" );
+
+    /*
+      Read the contents of a file pointed to by pathOrID as a vector of
+      vectors, split on all provided delimiting characters. If pathOrID is a
+      stored ID, the ID's target will be used as the target filepath, otherwise
+      pathOrID will be used as the target filepath. There does not need to be
+      an open stream on the filepath. Will reset an open filestream to its
+      filestart before reading.
+      Ex: Path Map contains [ { "data", "/dir/data/file.txt" } ]
+        readFileToMatrix( "data", ",", "\n\r" ) -> reads the contents of
+          "/dir/data/file.txt", split horizontally on the ',' character, and
+          split vertically on the '\n' and '\r' characters.
+    */
+    std::vector< std::vector< hst::hstring > > readFileToMatrix(
+      hst::hstring const & pathOrID,
+      hst::hstring const & lineDelim = L",",
+      hst::hstring const & vertDelim = L"\n\r" );
+
+    /*
+      Map the file pointed to by pathOrID into memory, read-only. If pathOrID
+      is a stored ID, the ID's target will be used as the target filepath,
+      otherwise pathOrID will be used as the target filepath. No copy of the
+      file is made; its bytes are accessed through the returned MappedFile.
+      Ex: Path Map contains [ { "data", "/dir/data/file.txt" } ]
+        mapFile( "data" ).view() -> the bytes of "/dir/data/file.txt"
+    */
+    MappedFile mapFile( hst::hstring const & pathOrID ) const;
+
+    /*
+      Read the contents of a file pointed to by pathOrID into one contiguous
+      vector per column, parsing every cell as its column's type. Integral
+      and floating point columns are parsed with std::from_chars, ignoring
+      surrounding spaces and tabs; std::string columns are copied. Large
+      files are split at row boundaries and parsed in parallel. Rows are
+      split in the same way as readFileToMatrix, but cells are split on
+      every delimiter, so empty cells are kept: an empty std::string cell is
+      loaded as "", and an empty numeric cell cannot be parsed. Every row
+      must have exactly one cell per column. Throws ParseError on the first
+      cell that cannot be parsed. Will reset an open filestream to its
+      filestart before reading.
+      Ex: Path Map contains [ { "data", "/dir/data/file.csv" } ]
+        readFileToColumns< std::int64_t, double >( "data", ",", "\n\r" ) ->
+          a tuple of an std::int64_t vector and a double vector.
+    */
+    template < typename... ColumnTypes >
+    std::tuple< std::vector< ColumnTypes >... > readFileToColumns(
+      hst::hstring const & pathOrID,
+      hst::hstring const & lineDelim = L",",
+      hst::hstring const & vertDelim = L"\n\r" );
+
+    /*
+      Read the contents of a file pointed to by pathOrID into one contiguous
+      vector per column, as with the typed readFileToColumns, with the column
+      types given at runtime.
+      Ex: readFileToColumns( "data", { ColumnType::Text, ColumnType::Real } )
+        -> a std::string column and a double column.
+    */
+    std::vector< Column > readFileToColumns(
+      hst::hstring const & pathOrID,
+      std::vector< ColumnType > const & schema,
+      hst::hstring const & lineDelim = L",",
+      hst::hstring const & vertDelim = L"\n\r" );
+
+    /*
+      Copy the file pointed to by sourcePathOrID to the filepath pointed to
+      by destinationPathOrID, replacing any file there. The bytes are copied
+      unaltered by the kernel where possible, sharing the source's blocks on
+      filesystems supporting reflinks. The copy is written to a temporary
+      file beside the destination and renamed over it, so readers see either
+      the old file or the complete copy.
+      Ex: copyFile( "data", "/backup/file.txt" ) -> "/backup/file.txt" holds
+        the bytes of "/dir/data/file.txt"
+    */
+    FIO & copyFile( hst::hstring const & sourcePathOrID,
+                    hst::hstring const & destinationPathOrID );
+
+    /*
+      Move the file pointed to by sourcePathOrID to the filepath pointed to
+      by destinationPathOrID, replacing any file there. Files are renamed
+      where possible. Moves across filesystems copy the file as copyFile
+      does, then delete the source. Path Map IDs are not updated, and moving
+      a file with an open stream on the source or destination throws.
+      Ex: moveFile( "data", "/archive/file.txt" ) -> "/dir/data/file.txt" is
+        now "/archive/file.txt"
+    */
+    FIO & moveFile( hst::hstring const & sourcePathOrID,
+                    hst::hstring const & destinationPathOrID );
+
+    /*
+      Replace the file pointed to by pathOrID with contents, written
+      unaltered. The contents are written to a pre-sized temporary file
+      beside it, flushed to disk, and renamed over the file, so readers see
+      either the old or the new contents, even after a crash. Permissions of
+      a replaced file are kept.
+      Ex: atomicWriteFile( "data", "a,b\n" ) -> "/dir/data/file.txt" holds
+        "a,b\n"
+    */
+    FIO & atomicWriteFile( hst::hstring const & pathOrID,
+                           std::string_view const & contents );
+
+    // Finds the application's root directory (Where the executable is located).
+    hst::hstring findRootDir() const;
+
+    /*
+      Sets the root directory of FIO to the filepath pointed to by pathOrID. If
+      pathOrID is a stored ID, the ID's target will be used as the root
+      filepath, otherwise pathOrID will be used as the root filepath.
+      Ex: Path Map contains [ { "data", "/dir/data/file.txt" } ]
+        setRootDir( "data") -> sets the root dir to "/dir/data/file.txt"
+        setRootDir( "/dir/data/pictures" ) -> sets the root dir to
+          "/dir/data/pictures"
+    */
+    FIO & setRootDir( hst::hstring const & pathOrID );
+
+    // Returns the root directory's currently stored filepath.
+    hst::hstring getRootDir() const;
+
+    /*
+      Stores the path provided in the Path Map at the ID provided. The path
+      can then be accessed using the ID for convenience. The ID "__root" is
+      reserved by FIO, and may only be changed using the FIO::setRootDir()
+      member function.
+    */
+    FIO & storePathAtID( hst::hstring const & ID, hst::hstring const & path );
+
+    /*
+      Returns the absolute filesystem path associated with the ID stored in the
+      FIO path map. If the ID provided is not contained in the path map, it
+      will be returned unaltered.
+      Ex: Path map contains [ { "data", "/dir/data" },
+          { "users", "/dir/users" } ]
+        getPath( "data" ) -> "/dir/data"
+        getPath( "users" ) -> "/dir/users"
+        getPath( "/dir/images" ) -> "/dir/images"
+        getPath( "invalid" ) -> "invalid"
+    */
+    hst::hstring getPath( hst::hstring const & pathOrID ) const;
+
+    // Removes the path located in the FIO path map at the ID provided.
+    FIO & removePathAtID( hst::hstring const & ID );
+
+    /*
+      Turn the recording of I/O statistics on or off. Statistics are only
+      recorded when FIO is compiled with FIO_ENABLE_STATS defined, otherwise
+      this does nothing, and no call pays for the feature.
+      Ex: fio.enableStats() -> fio.readFile( "data" ) is counted
+    */
+    FIO & enableStats( bool const & enable = true );
+
+    // Check if I/O statistics are being recorded.
+    bool statsEnabled() const;
+
+    /*
+      A snapshot of the I/O statistics recorded by every thread using this
+      FIO object, with the Path Map IDs pointing to each path.
+      Ex: fio.stats().toJSON() -> { "enabled": true, "operations": ... }
+    */
+    IOStats stats() const;
+
+    // Discard the I/O statistics recorded so far.
+    FIO & resetStats();
+
+    private:
+#ifdef WINDOWS
+    // The string type of filepaths passed to the operating system.
+    using NativePath = std::wstring;
+#else
+    // The string type of filepaths passed to the operating system.
+    using NativePath = std::string;
+#endif
+
+    // Receives the matching files of one directory.
+    using FilesFoundCallback =
+      std::function< void( std::vector< NativePath > && ) >;
+
+    // The state shared by the threads of one findFiles call.
+    struct FileSearch
+    {
+      FileSearch( hst::hstring const & fileExtension,
+                  bool const & recursiveSearch ) :
+        filter( fileExtension ), recursiveSearch( recursiveSearch )
+      {
+      }
+
+      // The file names to look for.
+      FileFilter filter;
+      // Whether to search through sub-directories.
+      bool recursiveSearch;
+      // The matching files of each directory searched.
+      ResultQueue< std::vector< NativePath > > foundFiles;
+      // Guards linkedDirectories.
+      std::mutex lock;
+      // The directories reached through symbolic links so far.
+      std::set< std::pair< dev_t, ino_t > > linkedDirectories;
+      // The tasks searching sub-directories.
+      TaskGroup group;
+#ifdef FIO_ENABLE_STATS
+      // The directories read so far.
+      std::atomic< std::uint64_t > directoriesVisited{ 0 };
+      // The entries stat'ed so far to learn their type.
+      std::atomic< std::uint64_t > entriesStatted{ 0 };
+#endif
+    };
+
+    // Reads files on the shared TaskPool, passing each result to resultSink
+    // on the calling thread, along with the file's index in pathsOrIDs.
+    template < typename ResultSink >
+    std::size_t readFiles( std::vector< hst::hstring > const & pathsOrIDs,
+                           std::size_t const & maxInFlight,
+                           ResultSink const & resultSink );
+    // The key of a directory in directoryIndexes, without trailing
+    // separators, so that "dir" and "dir/" share an index.
+    static std::wstring directoryKey( hst::hstring const & directory );
+    // The index of a directory, or nullptr if it is not indexed or its index
+    // is degraded.
+    std::shared_ptr< DirectoryIndex > findDirectoryIndex(
+      hst::hstring const & directory ) const;
+    // Runs a parallel file search from the directory pointed to by pathOrID,
+    // passing the files found to onFilesFound on the calling thread, and
+    // adding the directories it reads to scope.
+    void searchFiles( hst::hstring const & fileExtension,
+                      hst::hstring const & pathOrID,
+                      bool const & recursiveSearch,
+                      FilesFoundCallback const & onFilesFound,
+                      IOStatsRecorder::Scope & scope ) const;
+    // Searches one directory, queueing a task for each sub-directory.
+    static void searchDirectory( FileSearch & search,
+                                 NativePath const & directory );
+
+    // Copies between two resolved filepaths, as copyFile does.
+    static void copyResolvedFile( hst::hstring const & source,
+                                  hst::hstring const & destination );
+    // A filepath for a temporary file beside path, unique to this process.
+    static hst::hstring tempPathFor( hst::hstring const & path );
+#ifndef WINDOWS
+    // Creates and opens a temporary file beside path. Returns 0 or an errno
+    // value.
+    static int createTempFile( hst::hstring const & path,
+                               mode_t const & mode,
+                               std::string & tempPath,
+                               int & descriptor );
+    // Copies the contents of one open file to another, preferring reflinks,
+    // then copy_file_range, then sendfile, then a buffered copy. Sparse
+    // sources are not preallocated. Returns 0 or an errno value.
+    static int copyFileContents( int const & source,
+                                 int const & destination,
+                                 std::uint64_t const & size,
+                                 bool const & sparse );
+    // Flushes and closes a temporary file, then renames it over path. The
+    // temporary file is removed on failure. Returns 0 or an errno value.
+    static int commitTempFile( int const & descriptor,
+                               std::string const & tempPath,
+                               std::string const & path );
+    // Flushes the directory holding path, making renames in it durable.
+    static void syncDirectory( std::string const & path );
+#endif
+
+    using PathMap = std::unordered_map< std::wstring, hst::hstring >;
+    using InputEntry = StreamEntry< std::wifstream >;
+    using OutputEntry = StreamEntry< std::wofstream >;
+    using BufferedEntry = StreamEntry< BufferedWriter >;
+
+    // Replaces the Path Map with a copy changed by update.
+    template < typename Update >
+    void updatePathMap( Update const & update );
+    // Rewinds the input stream open on path, if there is one.
+    void rewindOpenInputStream( hst::hstring const & path );
+
+    // A stream entry, locked for one operation by the validate functions.
+    template < typename Entry >
+    struct LockedEntry
+    {
+      std::shared_ptr< Entry > entry;
+      std::unique_lock< std::shared_mutex > guard;
+
+      Entry * operator->() const { return entry.get(); }
+    };
+
+    // Marks a stream entry removed from its slot as closed, once the
+    // operations holding it have finished.
+    template < typename Entry >
+    static void markClosed( std::shared_ptr< Entry > const & entry );
+    // Rewinds a locked input stream.
+    static std::wistream & rewindInputStream(
+      LockedEntry< InputEntry > const & entry );
+    // Reads one line from a locked input stream.
+    static hst::hstring readLine( LockedEntry< InputEntry > const & entry );
+    // The buffered output stream open on the handle's path, or nullptr.
+    std::shared_ptr< BufferedEntry > bufferedEntry(
+      PathHandle const & handle ) const;
+
+    // Checks that the handle points to a valid input stream, and returns it
+    // locked. Errors name the stream by ID if the handle is empty.
+    LockedEntry< InputEntry > validateInputStream(
+      PathHandle const & handle,
+      hst::hstring const & ID = hst::hstring() ) const;
+    // Checks that the handle points to a valid output stream, and returns it
+    // locked. Errors name the stream by ID if the handle is empty.
+    LockedEntry< OutputEntry > validateOutputStream(
+      PathHandle const & handle,
+      hst::hstring const & ID = hst::hstring() ) const;
+    // Checks that the handle points to a buffered output stream. Errors name
+    // the stream by ID if the handle is empty.
+    std::shared_ptr< BufferedEntry > validateBufferedOutputStream(
+      PathHandle const & handle,
+      hst::hstring const & ID = hst::hstring() ) const;
+
+    // The Path Map in which path shorthands to files and directories are
+    // stored. Readers use the current snapshot through std::atomic_load, and
+    // writers replace it with an updated copy.
+    std::shared_ptr< PathMap const > pathIDM =
+      std::make_shared< PathMap const >();
+    // Serializes changes to the Path Map.
+    std::mutex pathIDMLock;
+    // The interned paths, each holding the streams open on it.
+    PathTable paths;
+    // Guards directoryIndexes.
+    mutable std::mutex directoryIndexLock;
+    // The indexes answering findFiles calls, by directoryKey.
+    std::unordered_map< std::wstring, std::shared_ptr< DirectoryIndex > >
+      directoryIndexes;
+    // Records I/O statistics, when they are compiled in and turned on.
+    mutable IOStatsRecorder statsRecorder;
+  };
+
+  inline hst::hstring parentDir( hst::hstring const & path )
+  {
+    auto str = path.wstr();
+    auto const delim = str.find_last_of( L"/\\" );
+
+    if ( delim != std::wstring::npos ) { str = str.substr( 0, delim ); }
+    return str;
+  }
+
+  inline hst::hstring baseFile(
+    hst::hstring const & pathToFile,
+    bool const & stripExtension /* = StripExtensionTrue */ )
+  {
+    auto const directoryPath = parentDir( pathToFile ).wstr();
+    auto filePath = pathToFile.wstr();
+
+    if ( directoryPath.size() < filePath.size() )
+    {
+      filePath = filePath.substr( directoryPath.size() + 1 );
+    }
+    if ( stripExtension == StripExtensionTrue )
+    {
+      auto const delim = filePath.find_last_of( L"." );
+
+      if ( delim != std::wstring::npos )
+      {
+        filePath = filePath.substr( 0, delim );
+      }
+    }
+    return filePath;
+  }
+
+  inline std::vector< hst::hstring > splitString(
+    hst::hstring const & source, hst::hstring const & delim /* = L"\n\r" */ )
+  {
+    std::vector< hst::hstring > splitStr;
+
+    // Wide strings are only split as multi-byte strings if converting them
+    // loses nothing, which fails for non-ASCII text in the C locale.
+    if ( hst::isByteSearchable( delim ) &&
+         ( ! source.storesWide() ||
+           hst::isCompleteConversion( source.wstr(), source.str() ) ) )
+    {
+      for ( auto const & it : Tokenizer( source.str(), delim.str() ) )
+      {
+        splitStr.push_back( std::string( it ) );
+      }
+      return splitStr;
+    }
+
+    auto const str = source.wstr();
+    auto const del = delim.wstr();
+    std::size_t start = 0;
+    std::size_t i;
+
+    while ( ( i = str.find_first_of( del, start ) ) != std::wstring::npos )
+    {
+      if ( i > start ) { splitStr.push_back( str.substr( start, i - start ) ); }
+      start = i + 1;
+    }
+    if ( start < str.size() ) { splitStr.push_back( str.substr( start ) ); }
+
+    return splitStr;
+  }
+
+  inline std::vector< std::string_view > splitStringView(
+    std::string_view const & source,
+    std::string_view const & delim /* = "\n\r" */ )
+  {
+    std::vector< std::string_view > splitStr;
+
+    for ( auto const & it : Tokenizer( source, delim ) )
+    {
+      splitStr.push_back( it );
+    }
+    return splitStr;
+  }
+
+  // Retrieve the index of the lowest set bit of a non-zero mask.
+  inline std::size_t lowestSetBit( unsigned int const & mask )
+  {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward( &index, mask );
+    return index;
+#else
+    return static_cast< std::size_t >( __builtin_ctz( mask ) );
+#endif
+  }
+
+  inline DelimiterSet::DelimiterSet( std::string_view const & delim )
+  {
+    for ( auto const & it : delim )
+    {
+      isDelimiter[ static_cast< unsigned char >( it ) ] = true;
+    }
+
+    std::size_t count = 0;
+
+    for ( std::size_t i = 0; i < 256 && count <= MaxVectorDelimiters; ++i )
+    {
+      if ( ! isDelimiter[ i ] ) { continue; }
+      if ( count < MaxVectorDelimiters )
+      {
+        vectorDelimiters[ count ] = static_cast< char >( i );
+      }
+      ++count;
+    }
+    vectorDelimiterCount = count <= MaxVectorDelimiters ? count : 0;
+  }
+
+  inline std::size_t DelimiterSet::find( std::string_view const & source,
+                                         std::size_t start /* = 0 */ ) const
+  {
+    auto const size = source.size();
+    auto const data = source.data();
+    auto i = start;
+
+    if ( vectorDelimiterCount == 0 )
+    {
+      for ( ; i < size; ++i )
+      {
+        if ( contains( data[ i ] ) ) { return i; }
+      }
+      return std::string_view::npos;
+    }
+
+    // Unused needle slots repeat the first delimiter, so every slot can be
+    // compared against unconditionally.
+    char needles[ MaxVectorDelimiters ];
+
+    for ( std::size_t k = 0; k < MaxVectorDelimiters; ++k )
+    {
+      needles[ k ] =
+        vectorDelimiters[ k < vectorDelimiterCount ? k : 0 ];
+    }
+
+#ifdef FIO_AVX2
+    __m256i const wideNeedle0 = _mm256_set1_epi8( needles[ 0 ] );
+    __m256i const wideNeedle1 = _mm256_set1_epi8( needles[ 1 ] );
+    __m256i const wideNeedle2 = _mm256_set1_epi8( needles[ 2 ] );
+    __m256i const wideNeedle3 = _mm256_set1_epi8( needles[ 3 ] );
+
+    for ( ; i + 32 <= size; i += 32 )
+    {
+      __m256i const chunk =
+        _mm256_loadu_si256( reinterpret_cast< __m256i const * >( data + i ) );
+      __m256i const matches = _mm256_or_si256(
+        _mm256_or_si256( _mm256_cmpeq_epi8( chunk, wideNeedle0 ),
+                         _mm256_cmpeq_epi8( chunk, wideNeedle1 ) ),
+        _mm256_or_si256( _mm256_cmpeq_epi8( chunk, wideNeedle2 ),
+                         _mm256_cmpeq_epi8( chunk, wideNeedle3 ) ) );
+      auto const mask =
+        static_cast< unsigned int >( _mm256_movemask_epi8( matches ) );
+
+      if ( mask != 0 ) { return i + lowestSetBit( mask ); }
+    }
+#endif
+
+#if defined FIO_SSE2 || defined FIO_AVX2
+    __m128i const needle0 = _mm_set1_epi8( needles[ 0 ] );
+    __m128i const needle1 = _mm_set1_epi8( needles[ 1 ] );
+    __m128i const needle2 = _mm_set1_epi8( needles[ 2 ] );
+    __m128i const needle3 = _mm_set1_epi8( needles[ 3 ] );
+
+    for ( ; i + 16 <= size; i += 16 )
+    {
+      __m128i const chunk =
+        _mm_loadu_si128( reinterpret_cast< __m128i const * >( data + i ) );
+      __m128i const matches =
+        _mm_or_si128( _mm_or_si128( _mm_cmpeq_epi8( chunk, needle0 ),
+                                    _mm_cmpeq_epi8( chunk, needle1 ) ),
+                      _mm_or_si128( _mm_cmpeq_epi8( chunk, needle2 ),
+                                    _mm_cmpeq_epi8( chunk, needle3 ) ) );
+      auto const mask =
+        static_cast< unsigned int >( _mm_movemask_epi8( matches ) );
+
+      if ( mask != 0 ) { return i + lowestSetBit( mask ); }
+    }
+#endif
+
+    for ( ; i < size; ++i )
+    {
+      auto const c = data[ i ];
+
+      if ( c == needles[ 0 ] || c == needles[ 1 ] || c == needles[ 2 ] ||
+           c == needles[ 3 ] )
+      {
+        return i;
+      }
+    }
+    return std::string_view::npos;
+  }
+
+  inline bool Tokenizer::next( std::size_t & position,
+                               std::string_view & token ) const
+  {
+    while ( position < source.size() )
+    {
+      auto const i = delimiters.find( source, position );
+
+      if ( i == std::string_view::npos )
+      {
+        token = source.substr( position );
+        position = source.size();
+        return true;
+      }
+      if ( i > position )
+      {
+        token = source.substr( position, i - position );
+        position = i + 1;
+        return true;
+      }
+      position = i + 1;
+    }
+    return false;
+  }
+
+  inline void deleteFile( hst::hstring const & pathToFile )
+  {
+    try
+    {
+      std::remove( pathToFile.mb_str() );
+    }
+    catch ( std::exception & e )
+    {
+      throw std::runtime_error( ( "Could not remove file: \"" + pathToFile +
+                                  "\"." + "Error Message: \"" + e.what() +
+                                  "\"" )
+                                  .mb_str() );
+    }
+  }
+
+  inline MappedFile::MappedFile( hst::hstring const & pathToFile )
+  {
+#ifdef WINDOWS
+    HANDLE fileHandle = ::CreateFileW( pathToFile.wc_str(),
+                                       GENERIC_READ,
+                                       FILE_SHARE_READ | FILE_SHARE_WRITE,
+                                       NULL,
+                                       OPEN_EXISTING,
+                                       FILE_FLAG_SEQUENTIAL_SCAN,
+                                       NULL );
+
+    if ( fileHandle == INVALID_HANDLE_VALUE )
+    {
+      throw std::system_error(
+        static_cast< int >( ::GetLastError() ),
+        std::system_category(),
+        ( L"Could not map file \"" + pathToFile +
+          L"\". System Error Message" )
+          .mb_str() );
+    }
+
+    LARGE_INTEGER fileSize;
+
+    if ( ::GetFileSizeEx( fileHandle, &fileSize ) && fileSize.QuadPart > 0 )
+    {
+      mappingHandle =
+        ::CreateFileMappingW( fileHandle, NULL, PAGE_READONLY, 0, 0, NULL );
+
+      if ( mappingHandle != NULL )
+      {
+        mappedData = static_cast< char const * >(
+          ::MapViewOfFile( mappingHandle, FILE_MAP_READ, 0, 0, 0 ) );
+        mappedSize = static_cast< std::size_t >( fileSize.QuadPart );
+      }
+    }
+    ::CloseHandle( fileHandle );
+
+    if ( mappedData == nullptr )
+    {
+      release();
+
+      std::ifstream stream( pathToFile.wc_str(), std::ios::binary );
+      bufferedData.assign( std::istreambuf_iterator< char >( stream ),
+                           std::istreambuf_iterator< char >() );
+
+      if ( ! stream.is_open() || stream.bad() )
+      {
+        throw std::system_error(
+          static_cast< int >( ::GetLastError() ),
+          std::system_category(),
+          ( L"Could not read file \"" + pathToFile +
+            L"\". System Error Message" )
+            .mb_str() );
+      }
+    }
+#else
+    int const fileDescriptor =
+      ::open( pathToFile.mb_str(), O_RDONLY | O_CLOEXEC );
+
+    if ( fileDescriptor < 0 )
+    {
+      throw std::system_error(
+        errno,
+        std::system_category(),
+        ( L"Could not map file \"" + pathToFile +
+          L"\". System Error Message" )
+          .mb_str() );
+    }
+
+    struct stat info;
+
+    if ( ::fstat( fileDescriptor, &info ) == 0 && S_ISREG( info.st_mode ) &&
+         info.st_size > 0 )
+    {
+      void * const region = ::mmap( nullptr,
+                                    static_cast< std::size_t >( info.st_size ),
+                                    PROT_READ,
+                                    MAP_PRIVATE,
+                                    fileDescriptor,
+                                    0 );
+
+      if ( region != MAP_FAILED )
+      {
+        ::madvise( region,
+                   static_cast< std::size_t >( info.st_size ),
+                   MADV_SEQUENTIAL );
+        mappedData = static_cast< char const * >( region );
+        mappedSize = static_cast< std::size_t >( info.st_size );
+      }
+    }
+
+    if ( mappedData == nullptr )
+    {
+      char buffer[ 65536 ];
+      ::ssize_t bytesRead;
+
+      do
+      {
+        bytesRead = ::read( fileDescriptor, buffer, sizeof( buffer ) );
+
+        if ( bytesRead > 0 )
+        {
+          bufferedData.append( buffer,
+                               static_cast< std::size_t >( bytesRead ) );
+        }
+      } while ( bytesRead > 0 || ( bytesRead < 0 && errno == EINTR ) );
+
+      if ( bytesRead < 0 )
+      {
+        auto const error = errno;
+
+        ::close( fileDescriptor );
+        throw std::system_error(
+          error,
+          std::system_category(),
+          ( L"Could not read file \"" + pathToFile +
+            L"\". System Error Message" )
+            .mb_str() );
+      }
+    }
+    ::close( fileDescriptor );
+#endif
+  }
+
+  inline MappedFile::MappedFile( MappedFile && other ) noexcept :
+    mappedData( other.mappedData ),
+    mappedSize( other.mappedSize ),
+    bufferedData( std::move( other.bufferedData ) )
+#ifdef WINDOWS
+    ,
+    mappingHandle( other.mappingHandle )
+#endif
+  {
+    other.mappedData = nullptr;
+    other.mappedSize = 0;
+#ifdef WINDOWS
+    other.mappingHandle = NULL;
+#endif
+  }
+
+  inline MappedFile & MappedFile::operator=( MappedFile && other ) noexcept
+  {
+    if ( this != &other )
+    {
+      release();
+      std::swap( mappedData, other.mappedData );
+      std::swap( mappedSize, other.mappedSize );
+      bufferedData = std::move( other.bufferedData );
+#ifdef WINDOWS
+      std::swap( mappingHandle, other.mappingHandle );
+#endif
+    }
+    return *this;
+  }
+
+  inline MappedFile::~MappedFile() { release(); }
+
+  inline std::string_view MappedFile::view() const
+  {
+    if ( mappedData != nullptr )
+    {
+      return std::string_view( mappedData, mappedSize );
+    }
+    return bufferedData;
+  }
+
+  inline void MappedFile::release() noexcept
+  {
+#ifdef WINDOWS
+    if ( mappedData != nullptr ) { ::UnmapViewOfFile( mappedData ); }
+    if ( mappingHandle != NULL ) { ::CloseHandle( mappingHandle ); }
+    mappingHandle = NULL;
+#else
+    if ( mappedData != nullptr )
+    {
+      ::munmap( const_cast< char * >( mappedData ), mappedSize );
+    }
+#endif
+    mappedData = nullptr;
+    mappedSize = 0;
+    bufferedData.clear();
+  }
+
+  inline RecordReader::RecordReader(
+    hst::hstring const & pathToFile,
+    std::string_view const & delim /* = "\n\r" */,
+    std::size_t const & bufferSize /* = DefaultBufferSize */,
+    std::size_t const & bufferCount /* = DefaultBufferCount */ ) :
+    delimiters( delim ),
+    readAhead( std::make_unique< ReadAhead >(
+      pathToFile, std::max< std::size_t >( bufferSize, 1 ), bufferCount ) )
+  {
+  }
+
+  inline bool RecordReader::next( std::string_view & record )
+  {
+    carry.clear();
+
+    while ( true )
+    {
+      if ( carry.empty() )
+      {
+        while ( position < buffer.size() &&
+                delimiters.contains( buffer[ position ] ) )
+        {
+          ++position;
+        }
+      }
+
+      auto const end = delimiters.find( buffer, position );
+
+      if ( end != std::string_view::npos )
+      {
+        if ( carry.empty() )
+        {
+          record = buffer.substr( position, end - position );
+        }
+        else
+        {
+          carry.append( buffer.data() + position, end - position );
+          record = carry;
+        }
+        position = end + 1;
+        return true;
+      }
+
+      // The record continues in the next buffer.
+      carry.append( buffer.data() + position, buffer.size() - position );
+      position = 0;
+
+      if ( ! nextBuffer() )
+      {
+        record = carry;
+        return ! carry.empty();
+      }
+    }
+  }
+
+  inline bool RecordReader::nextBuffer()
+  {
+    auto & ring = *readAhead;
+    std::unique_lock< std::mutex > guard( ring.lock );
+
+    if ( holdingBuffer )
+    {
+      ++ring.released;
+      holdingBuffer = false;
+      ring.changed.notify_all();
+    }
+    buffer = std::string_view();
+
+    ring.changed.wait( guard, [ &ring ] {
+      return ring.filled > ring.released || ring.finished;
+    } );
+
+    if ( ring.filled > ring.released )
+    {
+      auto const slot = ring.released % ring.buffers.size();
+
+      buffer = std::string_view( ring.buffers[ slot ].get(),
+                                 ring.filledSizes[ slot ] );
+      holdingBuffer = true;
+      return true;
+    }
+    if ( ring.error != 0 )
+    {
+      throw std::system_error(
+        ring.error,
+        std::system_category(),
+        ( L"File \"" + ring.path +
+          L"\" could not be read. System Error Message" )
+          .mb_str() );
+    }
+    return false;
+  }
+
+  inline RecordReader::ReadAhead::ReadAhead( hst::hstring const & pathToFile,
+                                             std::size_t const & bufferSize,
+                                             std::size_t const & bufferCount ) :
+    path( pathToFile ), bufferSize( bufferSize )
+  {
+#ifdef WINDOWS
+    fileHandle = ::CreateFileW( pathToFile.wc_str(),
+                                GENERIC_READ,
+                                FILE_SHARE_READ | FILE_SHARE_WRITE,
+                                NULL,
+                                OPEN_EXISTING,
+                                FILE_FLAG_SEQUENTIAL_SCAN,
+                                NULL );
+
+    if ( fileHandle == INVALID_HANDLE_VALUE )
+    {
+      throw std::system_error(
+        static_cast< int >( ::GetLastError() ),
+        std::system_category(),
+        ( L"File \"" + pathToFile +
+          L"\" could not be opened. System Error Message" )
+          .mb_str() );
+    }
+#else
+    fileDescriptor = ::open( pathToFile.mb_str(), O_RDONLY | O_CLOEXEC );
+
+    if ( fileDescriptor < 0 )
+    {
+      throw std::system_error(
+        errno,
+        std::system_category(),
+        ( L"File \"" + pathToFile +
+          L"\" could not be opened. System Error Message" )
+          .mb_str() );
+    }
+  #ifdef POSIX_FADV_SEQUENTIAL
+    // Lets the kernel read further ahead than the ring itself.
+    ::posix_fadvise( fileDescriptor, 0, 0, POSIX_FADV_SEQUENTIAL );
+  #endif
+#endif
+
+    for ( std::size_t i = 0; i < std::max< std::size_t >( bufferCount, 2 );
+          ++i )
+    {
+      buffers.emplace_back( new char[ bufferSize ] );
+    }
+    filledSizes.resize( buffers.size() );
+    reader = std::thread( &ReadAhead::fill, this );
+  }
+
+  inline RecordReader::ReadAhead::~ReadAhead()
+  {
+    {
+      std::lock_guard< std::mutex > guard( lock );
+      stopping = true;
+    }
+    changed.notify_all();
+    reader.join();
+#ifdef WINDOWS
+    ::CloseHandle( fileHandle );
+#else
+    ::close( fileDescriptor );
+#endif
+  }
+
+  inline void RecordReader::ReadAhead::fill()
+  {
+    while ( true )
+    {
+      std::size_t slot;
+      {
+        std::unique_lock< std::mutex > guard( lock );
+
+        changed.wait( guard, [ this ] {
+          return stopping || filled - released < buffers.size();
+        } );
+        if ( stopping ) { return; }
+        slot = filled % buffers.size();
+      }
+
+      auto const bytesRead = readFully( buffers[ slot ].get(), bufferSize );
+      std::lock_guard< std::mutex > guard( lock );
+
+      if ( bytesRead < 0 )
+      {
+        finished = true;
+      }
+      else
+      {
+        filledSizes[ slot ] = static_cast< std::size_t >( bytesRead );
+        if ( bytesRead > 0 ) { ++filled; }
+        finished = static_cast< std::size_t >( bytesRead ) < bufferSize;
+      }
+      changed.notify_all();
+
+      if ( finished ) { return; }
+    }
+  }
+
+  inline std::ptrdiff_t RecordReader::ReadAhead::readFully(
+    char * target, std::size_t const & size )
+  {
+    std::size_t total = 0;
+
+    while ( total < size )
+    {
+#ifdef WINDOWS
+      DWORD bytesRead;
+
+      if ( ! ::ReadFile( fileHandle,
+                         target + total,
+                         static_cast< DWORD >(
+                           std::min< std::size_t >( size - total, 1 << 30 ) ),
+                         &bytesRead,
+                         NULL ) )
+      {
+        error = static_cast< int >( ::GetLastError() );
+        return -1;
+      }
+#else
+      auto const bytesRead =
+        ::read( fileDescriptor, target + total, size - total );
+
+      if ( bytesRead < 0 )
+      {
+        if ( errno == EINTR ) { continue; }
+        error = errno;
+        return -1;
+      }
+#endif
+      if ( bytesRead == 0 ) { break; }
+      total += static_cast< std::size_t >( bytesRead );
+    }
+    return static_cast< std::ptrdiff_t >( total );
+  }
+
+  inline TaskPool::TaskPool( std::size_t const & threadCount /* = hardware */ )
+  {
+    auto const workerCount = std::max< std::size_t >( threadCount, 1 );
+
+    for ( std::size_t i = 0; i < workerCount; ++i )
+    {
+      queues.push_back( std::make_unique< TaskQueue >() );
+    }
+    for ( std::size_t i = 0; i < workerCount; ++i )
+    {
+      threads.emplace_back( &TaskPool::work, this, i );
+    }
+  }
+
+  inline TaskPool::~TaskPool()
+  {
+    {
+      std::lock_guard< std::mutex > guard( sleepLock );
+      stopping = true;
+    }
+    wakeUp.notify_all();
+    for ( auto & it : threads ) { it.join(); }
+  }
+
+  inline TaskPool & TaskPool::shared()
+  {
+    static TaskPool pool;
+    return pool;
+  }
+
+  // The pool the calling thread works for, if any.
+  inline TaskPool const *& currentTaskPool()
+  {
+    static thread_local TaskPool const * pool = nullptr;
+    return pool;
+  }
+
+  // The index of the calling thread in its pool.
+  inline std::size_t & currentTaskQueue()
+  {
+    static thread_local std::size_t index = 0;
+    return index;
+  }
+
+  inline void TaskPool::submit( Task && task )
+  {
+    auto const index = currentTaskPool() == this
+      ? currentTaskQueue()
+      : nextQueue.fetch_add( 1, std::memory_order_relaxed ) % queues.size();
+
+    {
+      std::lock_guard< std::mutex > guard( queues[ index ]->lock );
+      queues[ index ]->tasks.push_back( std::move( task ) );
+    }
+    queuedTasks.fetch_add( 1 );
+
+    // Taking the lock orders this wake-up after a sleeping worker's check.
+    {
+      std::lock_guard< std::mutex > guard( sleepLock );
+    }
+    wakeUp.notify_one();
+  }
+
+  inline bool TaskPool::runOne(
+    TaskGroup const * const & group /* = nullptr */ )
+  {
+    if ( queuedTasks.load() == 0 ) { return false; }
+
+    auto const ownQueue = currentTaskPool() == this;
+    auto const start = ownQueue ? currentTaskQueue() : 0;
+    auto const runnable = [ &group ]( Task const & task ) {
+      return group == nullptr || task.group == group;
+    };
+    Task task;
+    bool found = false;
+
+    for ( std::size_t i = 0; i < queues.size() && ! found; ++i )
+    {
+      auto & queue = *queues[ ( start + i ) % queues.size() ];
+      std::lock_guard< std::mutex > guard( queue.lock );
+
+      if ( queue.tasks.empty() ) { continue; }
+
+      // Workers take their own newest task, and steal the oldest of others.
+      if ( ownQueue && i == 0 )
+      {
+        auto const it = std::find_if(
+          queue.tasks.rbegin(), queue.tasks.rend(), runnable );
+
+        if ( it == queue.tasks.rend() ) { continue; }
+        task = std::move( *it );
+        queue.tasks.erase( std::next( it ).base() );
+      }
+      else
+      {
+        auto const it =
+          std::find_if( queue.tasks.begin(), queue.tasks.end(), runnable );
+
+        if ( it == queue.tasks.end() ) { continue; }
+        task = std::move( *it );
+        queue.tasks.erase( it );
+      }
+      found = true;
+    }
+    if ( ! found ) { return false; }
+
+    queuedTasks.fetch_sub( 1 );
+
+    std::exception_ptr taskError;
+
+    try
+    {
+      task.function();
+    }
+    catch ( ... )
+    {
+      taskError = std::current_exception();
+    }
+    task.group->finish( taskError );
+    return true;
+  }
+
+  inline void TaskPool::work( std::size_t const & index )
+  {
+    currentTaskPool() = this;
+    currentTaskQueue() = index;
+
+    while ( true )
+    {
+      if ( runOne() ) { continue; }
+
+      std::unique_lock< std::mutex > guard( sleepLock );
+      wakeUp.wait( guard,
+                   [ this ] { return stopping || queuedTasks.load() > 0; } );
+      if ( stopping && queuedTasks.load() == 0 ) { return; }
+    }
+  }
+
+  inline TaskGroup::~TaskGroup()
+  {
+    try
+    {
+      wait();
+    }
+    catch ( ... )
+    {
+    }
+  }
+
+  inline TaskGroup & TaskGroup::run( std::function< void() > task )
+  {
+    pendingTasks.fetch_add( 1 );
+    pool.submit( TaskPool::Task { std::move( task ), this } );
+    return *this;
+  }
+
+  inline void TaskGroup::wait()
+  {
+    while ( pendingTasks.load() > 0 )
+    {
+      if ( runOne() ) { continue; }
+
+      std::unique_lock< std::mutex > guard( lock );
+      finished.wait_for( guard, std::chrono::milliseconds( 1 ), [ this ] {
+        return pendingTasks.load() == 0;
+      } );
+    }
+
+    std::lock_guard< std::mutex > guard( lock );
+
+    if ( error )
+    {
+      auto const taskError = error;
+      error = nullptr;
+      std::rethrow_exception( taskError );
+    }
+  }
+
+  inline void TaskGroup::finish( std::exception_ptr const & taskError )
+  {
+    std::lock_guard< std::mutex > guard( lock );
+
+    if ( taskError && ! error ) { error = taskError; }
+    if ( pendingTasks.fetch_sub( 1 ) == 1 ) { finished.notify_all(); }
+  }
+
+  template < typename Result >
+  inline void ResultQueue< Result >::push( Result && result )
+  {
+    {
+      std::lock_guard< std::mutex > guard( lock );
+      results.push_back( std::move( result ) );
+    }
+    ready.notify_one();
+  }
+
+  template < typename Result >
+  template < typename Consume >
+  inline void ResultQueue< Result >::drain( TaskGroup & group,
+                                            Consume const & consume )
+  {
+    std::vector< Result > batch;
+
+    while ( true )
+    {
+      {
+        std::lock_guard< std::mutex > guard( lock );
+        batch.swap( results );
+      }
+      if ( ! batch.empty() )
+      {
+        for ( auto & it : batch ) { consume( std::move( it ) ); }
+        batch.clear();
+        continue;
+      }
+      if ( group.runOne() ) { continue; }
+      if ( group.done() )
+      {
+        std::lock_guard< std::mutex > guard( lock );
+        if ( results.empty() ) { break; }
+        continue;
+      }
+
+      std::unique_lock< std::mutex > guard( lock );
+      ready.wait_for( guard, std::chrono::milliseconds( 1 ), [ this ] {
+        return ! results.empty();
+      } );
+    }
+    group.wait();
+  }
+
+  inline FileFilter::FileFilter( hst::hstring const & patterns /* = L".*" */ )
+  {
+    for ( auto const & it : Tokenizer( patterns.str(), ";" ) )
+    {
+      if ( it == ".*" ) { matchesEverything = true; }
+      else if ( it.find_first_of( "*?[" ) != std::string_view::npos )
+      {
+        globs.emplace_back( it );
+      }
+      else { extensions.emplace_back( it ); }
+    }
+    if ( extensions.empty() && globs.empty() ) { matchesEverything = true; }
+  }
+
+  inline bool FileFilter::matches( std::string_view const & fileName ) const
+  {
+    if ( matchesEverything ) { return true; }
+
+    for ( auto const & it : extensions )
+    {
+      if ( fileName.size() > it.size() &&
+           fileName.compare( fileName.size() - it.size(), it.size(), it ) == 0 )
+      {
+        return true;
+      }
+    }
+    for ( auto const & it : globs )
+    {
+      if ( globMatches( it, fileName ) ) { return true; }
+    }
+    return false;
+  }
+
+  inline bool FileFilter::globMatches( std::string_view const & pattern,
+                                       std::string_view const & fileName )
+  {
+    std::size_t p = 0;
+    std::size_t f = 0;
+    // Where to resume after the most recent '*' if the match fails.
+    std::size_t starPattern = std::string_view::npos;
+    std::size_t starFile = 0;
+
+    while ( f < fileName.size() )
+    {
+      bool matched = false;
+      auto next = p + 1;
+
+      if ( p < pattern.size() && pattern[ p ] == '*' )
+      {
+        starPattern = ++p;
+        starFile = f;
+        continue;
+      }
+      if ( p < pattern.size() && pattern[ p ] == '?' ) { matched = true; }
+      else if ( p < pattern.size() && pattern[ p ] == '[' )
+      {
+        auto i = p + 1;
+        auto const negated =
+          i < pattern.size() && ( pattern[ i ] == '!' || pattern[ i ] == '^' );
+
+        if ( negated ) { ++i; }
+
+        bool inClass = false;
+        auto const first = i;
+
+        while ( i < pattern.size() && ( pattern[ i ] != ']' || i == first ) )
+        {
+          if ( i + 2 < pattern.size() && pattern[ i + 1 ] == '-' &&
+               pattern[ i + 2 ] != ']' )
+          {
+            // Bytes are compared unsigned, so ranges reaching past 0x7F
+            // hold the bytes of UTF-8 names.
+            auto const byte = static_cast< unsigned char >( fileName[ f ] );
+
+            if ( byte >= static_cast< unsigned char >( pattern[ i ] ) &&
+                 byte <= static_cast< unsigned char >( pattern[ i + 2 ] ) )
+            {
+              inClass = true;
+            }
+            i += 3;
+          }
+          else
+          {
+            if ( fileName[ f ] == pattern[ i ] ) { inClass = true; }
+            ++i;
+          }
+        }
+        if ( i < pattern.size() )
+        {
+          matched = inClass != negated;
+          next = i + 1;
+        }
+        else { matched = fileName[ f ] == '['; }
+      }
+      else if ( p < pattern.size() )
+      {
+        matched = pattern[ p ] == fileName[ f ];
+      }
+
+      if ( matched )
+      {
+        p = next;
+        ++f;
+      }
+      else if ( starPattern != std::string_view::npos )
+      {
+        p = starPattern;
+        f = ++starFile;
+      }
+      else { return false; }
+    }
+    while ( p < pattern.size() && pattern[ p ] == '*' ) { ++p; }
+    return p == pattern.size();
+  }
+
+  inline BufferedWriter::BufferedWriter(
+    hst::hstring const & pathToFile,
+    bool const & appendToFile /* = OpenNewFile */,
+    std::size_t const & maxPendingBytes /* = 1 << 26 */ ) :
+    path( pathToFile ), maxPendingBytes( maxPendingBytes )
+  {
+#ifdef WINDOWS
+    fileHandle = ::CreateFileW( pathToFile.wc_str(),
+                                appendToFile ? FILE_APPEND_DATA : GENERIC_WRITE,
+                                FILE_SHARE_READ,
+                                NULL,
+                                appendToFile ? OPEN_ALWAYS : CREATE_ALWAYS,
+                                FILE_ATTRIBUTE_NORMAL,
+                                NULL );
+
+    if ( fileHandle == INVALID_HANDLE_VALUE )
+    {
+      throw std::system_error(
+        static_cast< int >( ::GetLastError() ),
+        std::system_category(),
+        ( L"Output stream \"" + pathToFile +
+          L"\" could not be opened. System Error Message" )
+          .mb_str() );
+    }
+#else
+    fileDescriptor = ::open( pathToFile.mb_str(),
+                             O_WRONLY | O_CREAT | O_CLOEXEC |
+                               ( appendToFile ? O_APPEND : O_TRUNC ),
+                             0666 );
+
+    if ( fileDescriptor < 0 )
+    {
+      throw std::system_error(
+        errno,
+        std::system_category(),
+        ( L"Output stream \"" + pathToFile +
+          L"\" could not be opened. System Error Message" )
+          .mb_str() );
+    }
+#endif
+    flusher = std::thread( &BufferedWriter::flushLoop, this );
+  }
+
+  inline BufferedWriter::~BufferedWriter()
+  {
+    {
+      std::lock_guard< std::mutex > guard( appendLock );
+      submitCurrentChunk();
+    }
+    {
+      std::lock_guard< std::mutex > guard( flushLock );
+      stopping = true;
+    }
+    wakeFlusher.notify_one();
+    flusher.join();
+
+#ifdef WINDOWS
+    ::CloseHandle( fileHandle );
+#else
+    ::close( fileDescriptor );
+#endif
+
+    for ( auto list : { currentChunk, freeChunks, writtenChunks.load() } )
+    {
+      while ( list != nullptr )
+      {
+        auto const next = list->next;
+        delete list;
+        list = next;
+      }
+    }
+  }
+
+  inline BufferedWriter & BufferedWriter::write( std::string_view const & data )
+  {
+    std::optional< IOStatsRecorder::Scope > scope;
+
+    if ( statsRecorder != nullptr )
+    {
+      scope.emplace( *statsRecorder, path, IOOperation::WriteLine );
+    }
+    checkError();
+
+    auto const pending = pendingBytes.fetch_add( data.size() ) + data.size();
+    std::size_t written = 0;
+    bool submitted = false;
+
+    // The lock is held for the whole copy, so concurrent writes never
+    // interleave. Missing chunks are allocated with the lock released
+    // beforehand, so other writers are not held up by the allocator.
+    std::unique_lock< std::mutex > guard( appendLock );
+
+    while ( true )
+    {
+      auto const space =
+        currentChunk == nullptr ? 0 : ChunkCapacity - currentChunk->size;
+      auto const neededChunks = data.size() <= space
+        ? 0
+        : ( data.size() - space + ChunkCapacity - 1 ) / ChunkCapacity;
+
+      if ( freeChunkCount < neededChunks ) { reclaimWrittenChunks(); }
+      if ( freeChunkCount >= neededChunks ) { break; }
+
+      auto const missingChunks = neededChunks - freeChunkCount;
+      Chunk * allocated = nullptr;
+
+      guard.unlock();
+      for ( std::size_t i = 0; i < missingChunks; ++i )
+      {
+        auto const chunk = new ( std::nothrow ) Chunk;
+
+        if ( chunk == nullptr )
+        {
+          while ( allocated != nullptr )
+          {
+            auto const next = allocated->next;
+            delete allocated;
+            allocated = next;
+          }
+          pendingBytes.fetch_sub( data.size() );
+          throw std::bad_alloc();
+        }
+        chunk->next = allocated;
+        allocated = chunk;
+      }
+      guard.lock();
+
+      while ( allocated != nullptr )
+      {
+        auto const next = allocated->next;
+        allocated->next = freeChunks;
+        freeChunks = allocated;
+        ++freeChunkCount;
+        allocated = next;
+      }
+    }
+
+    while ( written < data.size() )
+    {
+      if ( currentChunk == nullptr )
+      {
+        currentChunk = freeChunks;
+        freeChunks = freeChunks->next;
+        --freeChunkCount;
+        currentChunk->size = 0;
+      }
+
+      auto const length =
+        std::min( data.size() - written, ChunkCapacity - currentChunk->size );
+
+      std::memcpy( currentChunk->data + currentChunk->size,
+                   data.data() + written,
+                   length );
+      currentChunk->size += length;
+      written += length;
+
+      if ( currentChunk->size == ChunkCapacity )
+      {
+        submitCurrentChunk();
+        submitted = true;
+      }
+    }
+
+    // The first bytes left waiting in a partly filled chunk start the
+    // flusher's timer.
+    auto const armTimer = currentChunk != nullptr &&
+      currentChunk->size > 0 && ! partialChunk.exchange( true );
+
+    if ( pending > maxPendingBytes )
+    {
+      submitCurrentChunk();
+      guard.unlock();
+
+      std::unique_lock< std::mutex > flushGuard( flushLock );
+      wakeFlusher.notify_one();
+      chunksWritten.wait( flushGuard, [ this ] {
+        return pendingBytes.load() <= maxPendingBytes || writeError.load() != 0;
+      } );
+    }
+    else if ( submitted || armTimer )
+    {
+      guard.unlock();
+      {
+        std::lock_guard< std::mutex > flushGuard( flushLock );
+      }
+      wakeFlusher.notify_one();
+    }
+    if ( scope ) { scope->addBytesWritten( data.size() ); }
+    return *this;
+  }
+
+  inline BufferedWriter & BufferedWriter::flush()
+  {
+    std::unique_lock< std::mutex > appendGuard( appendLock );
+    submitCurrentChunk();
+    auto const target = submittedSequence;
+    appendGuard.unlock();
+
+    std::unique_lock< std::mutex > guard( flushLock );
+    wakeFlusher.notify_one();
+    chunksWritten.wait( guard, [ this, target ] {
+      return writtenSequence.load() >= target || writeError.load() != 0;
+    } );
+    guard.unlock();
+
+    checkError();
+    return *this;
+  }
+
+  inline BufferedWriter & BufferedWriter::sync()
+  {
+    flush();
+#ifdef WINDOWS
+    if ( ! ::FlushFileBuffers( fileHandle ) )
+    {
+      writeError = static_cast< int >( ::GetLastError() );
+    }
+#else
+    if ( ::fsync( fileDescriptor ) < 0 ) { writeError = errno; }
+#endif
+    checkError();
+    return *this;
+  }
+
+  inline void BufferedWriter::submitCurrentChunk()
+  {
+    if ( currentChunk == nullptr || currentChunk->size == 0 ) { return; }
+
+    partialChunk = false;
+    currentChunk->sequence = ++submittedSequence;
+    currentChunk->next = fullChunks.load( std::memory_order_relaxed );
+    while ( ! fullChunks.compare_exchange_weak(
+      currentChunk->next, currentChunk, std::memory_order_release ) )
+    {
+    }
+    currentChunk = nullptr;
+  }
+
+  inline void BufferedWriter::reclaimWrittenChunks()
+  {
+    for ( auto it = writtenChunks.exchange( nullptr ); it != nullptr; )
+    {
+      auto const next = it->next;
+      it->next = freeChunks;
+      freeChunks = it;
+      ++freeChunkCount;
+      it = next;
+    }
+  }
+
+  inline void BufferedWriter::flushLoop()
+  {
+    std::vector< Chunk * > chunks;
+
+    while ( true )
+    {
+      bool stop;
+      {
+        std::unique_lock< std::mutex > guard( flushLock );
+
+        // Idle writers sleep until bytes are appended, and the timer only
+        // runs while a partly filled chunk is waiting.
+        wakeFlusher.wait( guard, [ this ] {
+          return stopping || fullChunks.load() != nullptr ||
+            partialChunk.load();
+        } );
+
+        auto const woken = wakeFlusher.wait_for(
+          guard,
+          std::chrono::milliseconds( FlushIntervalMilliseconds ),
+          [ this ] { return stopping || fullChunks.load() != nullptr; } );
+        stop = stopping;
+
+        // Idle writers still get their partly filled chunk written.
+        if ( ! woken && appendLock.try_lock() )
+        {
+          submitCurrentChunk();
+          appendLock.unlock();
+        }
+      }
+
+      chunks.clear();
+      for ( auto it = fullChunks.exchange( nullptr, std::memory_order_acquire );
+            it != nullptr;
+            it = it->next )
+      {
+        chunks.push_back( it );
+      }
+      std::reverse( chunks.begin(), chunks.end() );
+
+      if ( ! chunks.empty() )
+      {
+        std::size_t writtenBytes = 0;
+
+        if ( writeError.load() == 0 ) { writeChunks( chunks ); }
+        for ( auto const & it : chunks ) { writtenBytes += it->size; }
+
+        writtenSequence.store( chunks.back()->sequence );
+        pendingBytes.fetch_sub( writtenBytes );
+
+        for ( auto const & it : chunks )
+        {
+          it->next = writtenChunks.load( std::memory_order_relaxed );
+          while ( ! writtenChunks.compare_exchange_weak(
+            it->next, it, std::memory_order_release ) )
+          {
+          }
+        }
+        {
+          std::lock_guard< std::mutex > guard( flushLock );
+        }
+        chunksWritten.notify_all();
+      }
+
+      if ( stop && fullChunks.load() == nullptr ) { return; }
+    }
+  }
+
+  inline void BufferedWriter::writeChunks(
+    std::vector< Chunk * > const & chunks )
+  {
+#ifdef WINDOWS
+    for ( auto const & it : chunks )
+    {
+      // Loop over short writes until the whole chunk is written.
+      for ( std::size_t written = 0; written < it->size; )
+      {
+        DWORD bytesWritten = 0;
+
+        if ( ! ::WriteFile( fileHandle,
+                            it->data + written,
+                            static_cast< DWORD >( it->size - written ),
+                            &bytesWritten,
+                            NULL ) )
+        {
+          writeError = static_cast< int >( ::GetLastError() );
+          return;
+        }
+        if ( bytesWritten == 0 )
+        {
+          writeError = ERROR_WRITE_FAULT;
+          return;
+        }
+        written += bytesWritten;
+      }
+    }
+#else
+    std::size_t const maxBatch = 64;
+    struct iovec batch[ maxBatch ];
+
+    for ( std::size_t first = 0; first < chunks.size(); first += maxBatch )
+    {
+      auto const count = std::min( maxBatch, chunks.size() - first );
+      std::size_t remainingBytes = 0;
+
+      for ( std::size_t i = 0; i < count; ++i )
+      {
+        batch[ i ].iov_base = chunks[ first + i ]->data;
+        batch[ i ].iov_len = chunks[ first + i ]->size;
+        remainingBytes += chunks[ first + i ]->size;
+      }
+
+      auto vectors = batch;
+      auto vectorCount = static_cast< int >( count );
+
+      while ( remainingBytes > 0 )
+      {
+        auto const bytesWritten =
+          ::writev( fileDescriptor, vectors, vectorCount );
+
+        if ( bytesWritten < 0 )
+        {
+          if ( errno == EINTR ) { continue; }
+          writeError = errno;
+          return;
+        }
+
+        // Skip past whatever a short write left behind.
+        auto skipped = static_cast< std::size_t >( bytesWritten );
+        remainingBytes -= skipped;
+        while ( vectorCount > 0 && skipped >= vectors->iov_len )
+        {
+          skipped -= vectors->iov_len;
+          ++vectors;
+          --vectorCount;
+        }
+        if ( vectorCount > 0 )
+        {
+          vectors->iov_base =
+            static_cast< char * >( vectors->iov_base ) + skipped;
+          vectors->iov_len -= skipped;
+        }
+      }
+    }
+#endif
+  }
+
+  inline void BufferedWriter::checkError() const
+  {
+    auto const error = writeError.load();
+
+    if ( error != 0 )
+    {
+      throw std::system_error(
+        error,
+        std::system_category(),
+        ( L"Output stream \"" + path +
+          L"\" could not be written to. System Error Message" )
+          .mb_str() );
+    }
+  }
+
+  inline hst::hstring PathHandle::path() const
+  {
+    if ( slot == nullptr ) { return hst::hstring(); }
+    return slot->path;
+  }
+
+  inline PathHandle PathTable::find( hst::hstring const & path ) const
+  {
+    auto const & key = path.wstr();
+    auto & shard = shardOf( key );
+    std::lock_guard< std::mutex > guard( shard.lock );
+    auto const it = shard.slots.find( key );
+
+    if ( it == shard.slots.end() ) { return PathHandle(); }
+    return PathHandle( it->second );
+  }
+
+  inline PathHandle PathTable::intern( hst::hstring const & path )
+  {
+    auto const & key = path.wstr();
+    auto & shard = shardOf( key );
+    std::lock_guard< std::mutex > guard( shard.lock );
+    auto const it = shard.slots.find( key );
+
+    if ( it != shard.slots.end() ) { return PathHandle( it->second ); }
+
+    // Sweeping only once the shard has doubled keeps interning amortized
+    // constant time.
+    if ( shard.slots.size() >= shard.sweepSize )
+    {
+      sweep( shard );
+      shard.sweepSize = std::max( MinSweepSize, 2 * shard.slots.size() );
+    }
+
+    auto const slot = std::make_shared< PathHandle::Slot >( path );
+
+    shard.slots.emplace( key, slot );
+    return PathHandle( slot );
+  }
+
+  inline void PathTable::release( hst::hstring const & path )
+  {
+    auto const & key = path.wstr();
+    auto & shard = shardOf( key );
+    std::lock_guard< std::mutex > guard( shard.lock );
+    auto const it = shard.slots.find( key );
+
+    if ( it != shard.slots.end() && isUnused( it->second ) )
+    {
+      shard.slots.erase( it );
+    }
+  }
+
+  inline void PathTable::prune()
+  {
+    for ( auto & shard : shards )
+    {
+      std::lock_guard< std::mutex > guard( shard.lock );
+
+      sweep( shard );
+      shard.sweepSize = std::max( MinSweepSize, 2 * shard.slots.size() );
+    }
+  }
+
+  inline std::vector< PathHandle > PathTable::handles() const
+  {
+    std::vector< PathHandle > interned;
+
+    for ( auto & shard : shards )
+    {
+      std::lock_guard< std::mutex > guard( shard.lock );
+
+      for ( auto const & it : shard.slots )
+      {
+        interned.push_back( PathHandle( it.second ) );
+      }
+    }
+    return interned;
+  }
+
+  inline std::size_t PathTable::size() const
+  {
+    std::size_t count = 0;
+
+    for ( auto & shard : shards )
+    {
+      std::lock_guard< std::mutex > guard( shard.lock );
+
+      count += shard.slots.size();
+    }
+    return count;
+  }
+
+  inline PathTable::Shard & PathTable::shardOf(
+    std::wstring const & path ) const
+  {
+    return shards[ std::hash< std::wstring >()( path ) % ShardCount ];
+  }
+
+  inline bool PathTable::isUnused(
+    std::shared_ptr< PathHandle::Slot > const & slot )
+  {
+    return slot.use_count() == 1 && ! std::atomic_load( &slot->input ) &&
+      ! std::atomic_load( &slot->output ) &&
+      ! std::atomic_load( &slot->buffered );
+  }
+
+  inline void PathTable::sweep( Shard & shard )
+  {
+    for ( auto it = shard.slots.begin(); it != shard.slots.end(); )
+    {
+      if ( isUnused( it->second ) ) { it = shard.slots.erase( it ); }
+      else { ++it; }
+    }
+  }
+
+  inline DirectoryIndex::DirectoryIndex(
+    hst::hstring const & rootDirectory,
+    bool const & watchChanges /* = WatchChangesTrue */ ) :
+    DirectoryIndex( rootDirectory, watchChanges, EmptySnapshot() )
+  {
+    scanTree( "", tree );
+    checkWatched();
+#ifdef __linux__
+    startWatching();
+#endif
+  }
+
+  inline DirectoryIndex::DirectoryIndex( hst::hstring const & rootDirectory,
+                                         bool const & watchChanges,
+                                         EmptySnapshot ) :
+    root( rootDirectory.str() )
+  {
+    while ( root.size() > 1 && root.back() == Separator ) { root.pop_back(); }
+
+#ifdef __linux__
+    if ( watchChanges )
+    {
+      inotifyDescriptor = ::inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+      stopDescriptor = ::eventfd( 0, EFD_CLOEXEC );
+
+      if ( inotifyDescriptor < 0 || stopDescriptor < 0 )
+      {
+        auto const error = errno;
+
+        if ( inotifyDescriptor >= 0 ) { ::close( inotifyDescriptor ); }
+        if ( stopDescriptor >= 0 ) { ::close( stopDescriptor ); }
+        throw std::system_error(
+          error,
+          std::system_category(),
+          ( L"Changes to \"" + rootDirectory +
+            L"\" could not be watched. System Error Message" )
+            .mb_str() );
+      }
+    }
+#else
+    static_cast< void >( watchChanges );
+#endif
+  }
+
+  inline DirectoryIndex::~DirectoryIndex()
+  {
+#ifdef __linux__
+    if ( watcher.joinable() )
+    {
+      std::uint64_t const wake = 1;
+
+      if ( ::write( stopDescriptor, &wake, sizeof( wake ) ) < 0 )
+      {
+        perror( "Could not stop the directory watcher." );
+      }
+      watcher.join();
+    }
+    if ( inotifyDescriptor >= 0 ) { ::close( inotifyDescriptor ); }
+    if ( stopDescriptor >= 0 ) { ::close( stopDescriptor ); }
+#endif
+  }
+
+  inline std::unique_ptr< DirectoryIndex > DirectoryIndex::load(
+    hst::hstring const & pathToFile,
+    bool const & watchChanges /* = WatchChangesTrue */ )
+  {
+#ifdef WINDOWS
+    std::ifstream stream( pathToFile.wc_str(), std::ios::binary );
+#else
+    std::ifstream stream( pathToFile.mb_str(), std::ios::binary );
+#endif
+    auto const corrupt = [ &pathToFile ] {
+      return std::runtime_error(
+        ( L"Directory index \"" + pathToFile +
+          L"\" could not be loaded. Hint: Was it saved by this version of "
+          L"FIO?" )
+          .mb_str() );
+    };
+    auto const readValue = [ &stream ]( auto & value ) {
+      stream.read( reinterpret_cast< char * >( &value ), sizeof( value ) );
+    };
+    auto const readString = [ &stream, &readValue ]( std::string & value ) {
+      std::uint32_t length = 0;
+
+      readValue( length );
+      if ( ! stream || length > FILENAME_MAX * 16 ) { return false; }
+      value.resize( length );
+      stream.read( &value[ 0 ], length );
+      return static_cast< bool >( stream );
+    };
+
+    char magic[ sizeof( IndexMagic ) ] = {};
+    std::string rootDirectory;
+
+    stream.read( magic, sizeof( magic ) );
+    if ( ! stream || std::memcmp( magic, IndexMagic, sizeof( magic ) ) != 0 ||
+         ! readString( rootDirectory ) )
+    {
+      throw corrupt();
+    }
+
+    std::unique_ptr< DirectoryIndex > index( new DirectoryIndex(
+      rootDirectory, watchChanges, EmptySnapshot() ) );
+    std::uint64_t directoryCount = 0;
+
+    readValue( directoryCount );
+    for ( std::uint64_t i = 0; i < directoryCount && stream; ++i )
+    {
+      std::string directory;
+      std::uint64_t fileCount = 0;
+
+      if ( ! readString( directory ) ) { break; }
+
+      auto & contents = index->tree.directories[ directory ];
+
+      readValue( contents.modified );
+      readValue( fileCount );
+      for ( std::uint64_t j = 0; j < fileCount && stream; ++j )
+      {
+        File file;
+
+        if ( ! readString( file.name ) ) { break; }
+        readValue( file.size );
+        readValue( file.modified );
+        contents.files.push_back( std::move( file ) );
+      }
+    }
+    if ( ! stream ) { throw corrupt(); }
+
+    // The saved directories, and the errors of their watches.
+    std::vector< std::pair< std::string, int > > directories;
+
+    for ( auto const & it : index->tree.directories )
+    {
+#ifndef WINDOWS
+      // Linked directories are not saved, so they are claimed again.
+      auto const path = index->fullPath( it.first );
+      struct stat info;
+
+      if ( ::lstat( path.c_str(), &info ) == 0 && S_ISLNK( info.st_mode ) &&
+           ::stat( path.c_str(), &info ) == 0 )
+      {
+        followLink( it.first, info, index->tree );
+      }
+#endif
+#ifdef __linux__
+      // Watched before being checked, so no change is missed.
+      directories.emplace_back(
+        it.first, index->watchDirectory( it.first, index->tree ) );
+#else
+      directories.emplace_back( it.first, 0 );
+#endif
+    }
+
+    // Re-read the directories which changed since the index was saved.
+    for ( auto const & it : directories )
+    {
+      auto const contents = index->tree.directories.find( it.first );
+      std::int64_t modified;
+
+      if ( contents == index->tree.directories.end() ) { continue; }
+      if ( ! directoryModified( index->fullPath( it.first ), modified ) )
+      {
+        index->removeTree( it.first );
+        continue;
+      }
+      if ( it.second != 0 ) { index->watchError = it.second; }
+      if ( modified != contents->second.modified )
+      {
+        index->rescanDirectory( it.first );
+      }
+    }
+    index->checkWatched();
+#ifdef __linux__
+    index->startWatching();
+#endif
+    return index;
+  }
+
+  inline void DirectoryIndex::save( hst::hstring const & pathToFile ) const
+  {
+#ifdef WINDOWS
+    std::ofstream stream( pathToFile.wc_str(), std::ios::binary );
+#else
+    std::ofstream stream( pathToFile.mb_str(), std::ios::binary );
+#endif
+    auto const writeValue = [ &stream ]( auto const & value ) {
+      stream.write( reinterpret_cast< char const * >( &value ),
+                    sizeof( value ) );
+    };
+    auto const writeString = [ &stream,
+                               &writeValue ]( std::string const & value ) {
+      writeValue( static_cast< std::uint32_t >( value.size() ) );
+      stream.write( value.data(), value.size() );
+    };
+
+    std::shared_lock< std::shared_mutex > guard( lock );
+
+    stream.write( IndexMagic, sizeof( IndexMagic ) );
+    writeString( root );
+    writeValue( static_cast< std::uint64_t >( tree.directories.size() ) );
+    for ( auto const & it : tree.directories )
+    {
+      writeString( it.first );
+      writeValue( it.second.modified );
+      writeValue( static_cast< std::uint64_t >( it.second.files.size() ) );
+      for ( auto const & file : it.second.files )
+      {
+        writeString( file.name );
+        writeValue( file.size );
+        writeValue( file.modified );
+      }
+    }
+    stream.flush();
+
+    if ( ! stream )
+    {
+      throw std::system_error(
+        errno,
+        std::system_category(),
+        ( L"Directory index \"" + pathToFile +
+          L"\" could not be saved. System Error Message" )
+          .mb_str() );
+    }
+  }
+
+  inline std::vector< hst::hstring > DirectoryIndex::findFiles(
+    hst::hstring const & fileExtension /* = L".*" */,
+    bool const & recursiveSearch /* = RecursiveSearchTrue */ ) const
+  {
+    FileFilter const filter( fileExtension );
+    std::vector< hst::hstring > foundFiles;
+    std::shared_lock< std::shared_mutex > guard( lock );
+
+    for ( auto it = tree.directories.begin(); it != tree.directories.end();
+          ++it )
+    {
+      if ( ! recursiveSearch && ! it->first.empty() ) { break; }
+
+      auto const directory = fullPath( it->first );
+
+      for ( auto const & file : it->second.files )
+      {
+        if ( filter.matches( file.name ) )
+        {
+          foundFiles.push_back( childPath( directory, file.name ) );
+        }
+      }
+    }
+    return foundFiles;
+  }
+
+  inline std::size_t DirectoryIndex::findFiles(
+    FileCallback const & onFileFound,
+    hst::hstring const & fileExtension /* = L".*" */,
+    bool const & recursiveSearch /* = RecursiveSearchTrue */ ) const
+  {
+    auto const foundFiles = findFiles( fileExtension, recursiveSearch );
+
+    for ( auto const & it : foundFiles ) { onFileFound( it ); }
+    return foundFiles.size();
+  }
+
+  inline DirectoryIndex & DirectoryIndex::rescan()
+  {
+    std::lock_guard< std::mutex > updateGuard( updateLock );
+
+    replaceTree();
+    return *this;
+  }
+
+  inline std::optional< DirectoryIndex::File > DirectoryIndex::findFile(
+    hst::hstring const & pathToFile ) const
+  {
+    auto const & path = pathToFile.str();
+    auto const delim = path.find_last_of( Separator );
+
+    if ( delim == std::string::npos ) { return std::nullopt; }
+
+    auto const name = path.substr( delim + 1 );
+    auto directory = path.substr( 0, delim );
+
+    // Turn the directory into its key relative to root.
+    if ( directory.compare( 0, root.size(), root ) != 0 )
+    {
+      return std::nullopt;
+    }
+    directory.erase( 0, root.size() );
+    if ( ! directory.empty() && root.back() != Separator )
+    {
+      if ( directory[ 0 ] != Separator ) { return std::nullopt; }
+      directory.erase( 0, 1 );
+    }
+
+    std::shared_lock< std::shared_mutex > guard( lock );
+    auto const contents = tree.directories.find( directory );
+
+    if ( contents != tree.directories.end() )
+    {
+      for ( auto const & it : contents->second.files )
+      {
+        if ( it.name == name ) { return it; }
+      }
+    }
+    return std::nullopt;
+  }
+
+  inline std::size_t DirectoryIndex::fileCount() const
+  {
+    std::shared_lock< std::shared_mutex > guard( lock );
+    std::size_t count = 0;
+
+    for ( auto const & it : tree.directories )
+    {
+      count += it.second.files.size();
+    }
+    return count;
+  }
+
+  inline void DirectoryIndex::scanTree( std::string const & directory,
+                                        Tree & into )
+  {
+#ifdef __linux__
+    // Watched before being read, so no change is missed.
+    auto const watched = watchDirectory( directory, into );
+#endif
+
+    Directory contents;
+    std::vector< std::string > subdirectories;
+
+    if ( ! readDirectory( directory, contents, subdirectories, into ) )
+    {
+#ifdef __linux__
+      unwatchDirectory( directory, into );
+#endif
+#ifndef WINDOWS
+      releaseLinks( directory, into );
+#endif
+      return;
+    }
+#ifdef __linux__
+    // A directory which can be read but not watched, for example once
+    // fs.inotify.max_user_watches is reached, leaves the snapshot stale.
+    if ( watched != 0 ) { watchError = watched; }
+#endif
+    into.directories[ directory ] = std::move( contents );
+
+    for ( auto const & it : subdirectories )
+    {
+      scanTree( childPath( directory, it ), into );
+    }
+  }
+
+  inline void DirectoryIndex::replaceTree()
+  {
+    Tree scanned;
+
+    watchError = 0;
+    scanTree( "", scanned );
+
+    std::unique_lock< std::shared_mutex > guard( lock );
+
+#ifdef __linux__
+    // Directories watched again keep their watch descriptors, so only the
+    // watches of directories which are gone are removed.
+    for ( auto const & it : tree.watchedDirectories )
+    {
+      if ( scanned.watchedDirectories.find( it.first ) ==
+           scanned.watchedDirectories.end() )
+      {
+        ::inotify_rm_watch( inotifyDescriptor, it.first );
+      }
+    }
+#endif
+    std::swap( tree, scanned );
+  }
+
+  inline void DirectoryIndex::checkWatched() const
+  {
+    if ( auto const error = watchError.load() )
+    {
+      throw std::system_error(
+        error,
+        std::system_category(),
+        ( L"Changes to \"" + hst::hstring( root ) +
+          L"\" could not all be watched. " +
+          L"Hint: Is fs.inotify.max_user_watches too low? " +
+          L"System Error Message" )
+          .mb_str() );
+    }
+  }
+
+  inline void DirectoryIndex::rescanDirectory( std::string const & directory )
+  {
+    Directory contents;
+    std::vector< std::string > subdirectories;
+
+    if ( ! readDirectory( directory, contents, subdirectories, tree ) )
+    {
+      removeTree( directory );
+      return;
+    }
+    tree.directories[ directory ] = std::move( contents );
+
+    // Remove the sub-tree.directories which no longer exist.
+    std::set< std::string > const present( subdirectories.begin(),
+                                           subdirectories.end() );
+    auto const prefix =
+      directory.empty() ? directory : directory + Separator;
+    std::vector< std::string > removed;
+
+    for ( auto it = directory.empty()
+            ? tree.directories.upper_bound( directory )
+            : tree.directories.lower_bound( prefix );
+          it != tree.directories.end() &&
+          it->first.compare( 0, prefix.size(), prefix ) == 0;
+          ++it )
+    {
+      auto const name = it->first.substr( prefix.size() );
+
+      if ( name.find( Separator ) == std::string::npos &&
+           present.find( name ) == present.end() )
+      {
+        removed.push_back( it->first );
+      }
+    }
+    for ( auto const & it : removed ) { removeTree( it ); }
+
+    for ( auto const & it : subdirectories )
+    {
+      auto const subdirectory = childPath( directory, it );
+
+      if ( tree.directories.find( subdirectory ) == tree.directories.end() )
+      {
+        scanTree( subdirectory, tree );
+      }
+    }
+  }
+
+  inline void DirectoryIndex::removeTree( std::string const & directory )
+  {
+    auto const prefix = directory.empty() ? directory : directory + Separator;
+
+#ifdef __linux__
+    unwatchDirectory( directory, tree );
+#endif
+#ifndef WINDOWS
+    releaseLinks( directory, tree );
+#endif
+    tree.directories.erase( directory );
+
+    auto it = tree.directories.lower_bound( prefix );
+
+    // Everything below the directory shares its key as a prefix.
+    while ( it != tree.directories.end() &&
+            it->first.compare( 0, prefix.size(), prefix ) == 0 )
+    {
+#ifdef __linux__
+      unwatchDirectory( it->first, tree );
+#endif
+      it = tree.directories.erase( it );
+    }
+  }
+
+  inline bool DirectoryIndex::readDirectory(
+    std::string const & directory,
+    Directory & contents,
+    std::vector< std::string > & subdirectories,
+    Tree & into )
+  {
+    auto const path = fullPath( directory );
+
+#ifdef WINDOWS
+    static_cast< void >( into );
+    if ( ! directoryModified( path, contents.modified ) ) { return false; }
+
+    WIN32_FIND_DATAW info;
+    HANDLE dirHandle =
+      ::FindFirstFileExW( ( hst::multiByteToWide( path ) + L"\\*" ).c_str(),
+                          FindExInfoBasic,
+                          &info,
+                          FindExSearchNameMatch,
+                          NULL,
+                          FIND_FIRST_EX_LARGE_FETCH );
+
+    if ( dirHandle == INVALID_HANDLE_VALUE ) { return false; }
+
+    do
+    {
+      std::wstring const fileName( info.cFileName );
+
+      if ( fileName == L"." || fileName == L".." ) { continue; }
+
+      if ( ! ( info.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY ) )
+      {
+        File file;
+
+        file.name = hst::wideToMultiByte( fileName );
+        file.size =
+          ( static_cast< std::uint64_t >( info.nFileSizeHigh ) << 32 ) |
+          info.nFileSizeLow;
+        file.modified = modifiedTime( info.ftLastWriteTime );
+        contents.files.push_back( std::move( file ) );
+      }
+      else if ( ! ( info.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT ) )
+      {
+        subdirectories.push_back( hst::wideToMultiByte( fileName ) );
+      }
+    } while ( ::FindNextFileW( dirHandle, &info ) );
+    ::FindClose( dirHandle );
+#else
+    int const dirDescriptor =
+      ::open( path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC );
+
+    if ( dirDescriptor < 0 ) { return false; }
+
+    struct stat info;
+
+    if ( ::fstat( dirDescriptor, &info ) == 0 )
+    {
+      contents.modified = modifiedTime( info );
+    }
+
+    DIR * const dirHandle = ::fdopendir( dirDescriptor );
+
+    if ( dirHandle == nullptr )
+    {
+      ::close( dirDescriptor );
+      return false;
+    }
+
+    struct dirent * dirInfo;
+
+    while ( ( dirInfo = ::readdir( dirHandle ) ) != nullptr )
+    {
+      char const * const fileName = dirInfo->d_name;
+
+      if ( fileName[ 0 ] == '.' &&
+           ( fileName[ 1 ] == '\0' ||
+             ( fileName[ 1 ] == '.' && fileName[ 2 ] == '\0' ) ) )
+      {
+        continue;
+      }
+      if ( dirInfo->d_type == DT_DIR )
+      {
+        subdirectories.push_back( fileName );
+        continue;
+      }
+      if ( ::fstatat( dirDescriptor, fileName, &info, AT_SYMLINK_NOFOLLOW ) <
+           0 )
+      {
+        continue;
+      }
+      if ( S_ISDIR( info.st_mode ) )
+      {
+        subdirectories.push_back( fileName );
+        continue;
+      }
+
+      // Symbolic links are indexed as the file or directory they point to.
+      if ( S_ISLNK( info.st_mode ) &&
+           ::fstatat( dirDescriptor, fileName, &info, 0 ) < 0 )
+      {
+        continue;
+      }
+      if ( S_ISDIR( info.st_mode ) )
+      {
+        if ( followLink( childPath( directory, fileName ), info, into ) )
+        {
+          subdirectories.push_back( fileName );
+        }
+        continue;
+      }
+      if ( S_ISREG( info.st_mode ) )
+      {
+        File file;
+
+        file.name = fileName;
+        file.size = static_cast< std::uint64_t >( info.st_size );
+        file.modified = modifiedTime( info );
+        contents.files.push_back( std::move( file ) );
+      }
+    }
+    ::closedir( dirHandle );
+#endif
+    return true;
+  }
+
+#ifndef WINDOWS
+  inline bool DirectoryIndex::followLink( std::string const & directory,
+                                          struct stat const & info,
+                                          Tree & into )
+  {
+    auto const followed = into.linkedDirectories.emplace(
+      std::make_pair( info.st_dev, info.st_ino ), directory );
+
+    return followed.second || followed.first->second == directory;
+  }
+
+  inline void DirectoryIndex::releaseLinks( std::string const & directory,
+                                            Tree & from )
+  {
+    auto const prefix = directory.empty() ? directory : directory + Separator;
+
+    for ( auto it = from.linkedDirectories.begin();
+          it != from.linkedDirectories.end(); )
+    {
+      if ( it->second == directory ||
+           it->second.compare( 0, prefix.size(), prefix ) == 0 )
+      {
+        it = from.linkedDirectories.erase( it );
+      }
+      else { ++it; }
+    }
+  }
+#endif
+
+  inline std::string DirectoryIndex::fullPath(
+    std::string const & directory ) const
+  {
+    if ( directory.empty() ) { return root; }
+    return childPath( root, directory );
+  }
+
+  inline std::string DirectoryIndex::childPath( std::string const & directory,
+                                                std::string const & name )
+  {
+    if ( directory.empty() ) { return name; }
+    if ( directory.back() == Separator ) { return directory + name; }
+    return directory + Separator + name;
+  }
+
+  inline bool DirectoryIndex::directoryModified( std::string const & path,
+                                                 std::int64_t & modified )
+  {
+#ifdef WINDOWS
+    WIN32_FILE_ATTRIBUTE_DATA info;
+
+    if ( ! ::GetFileAttributesExW( hst::multiByteToWide( path ).c_str(),
+                                   GetFileExInfoStandard,
+                                   &info ) ||
+         ! ( info.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY ) )
+    {
+      return false;
+    }
+    modified = modifiedTime( info.ftLastWriteTime );
+#else
+    struct stat info;
+
+    if ( ::stat( path.c_str(), &info ) < 0 || ! S_ISDIR( info.st_mode ) )
+    {
+      return false;
+    }
+    modified = modifiedTime( info );
+#endif
+    return true;
+  }
+
+#ifdef WINDOWS
+  inline std::int64_t DirectoryIndex::modifiedTime( FILETIME const & time )
+  {
+    // File times count 100ns intervals since 1601.
+    auto const intervals =
+      ( static_cast< std::int64_t >( time.dwHighDateTime ) << 32 ) |
+      time.dwLowDateTime;
+
+    return ( intervals - 116444736000000000LL ) * 100;
+  }
+#else
+  inline std::int64_t DirectoryIndex::modifiedTime( struct stat const & info )
+  {
+  #ifdef __APPLE__
+    auto const & time = info.st_mtimespec;
+  #else
+    auto const & time = info.st_mtim;
+  #endif
+    return static_cast< std::int64_t >( time.tv_sec ) * 1000000000 +
+      time.tv_nsec;
+  }
+#endif
+
+#ifdef __linux__
+  inline void DirectoryIndex::updateEntry( std::string const & directory,
+                                           std::string const & name )
+  {
+    auto const contents = tree.directories.find( directory );
+
+    if ( contents == tree.directories.end() ) { return; }
+
+    auto const path = childPath( fullPath( directory ), name );
+    auto const subdirectory = childPath( directory, name );
+    auto & files = contents->second.files;
+    struct stat info;
+    auto exists = ::lstat( path.c_str(), &info ) == 0;
+    auto const linked = exists && S_ISLNK( info.st_mode );
+
+    // Symbolic links are indexed as the file or directory they point to.
+    if ( linked ) { exists = ::stat( path.c_str(), &info ) == 0; }
+
+    if ( exists && S_ISDIR( info.st_mode ) &&
+         ( ! linked || followLink( subdirectory, info, tree ) ) )
+    {
+      if ( tree.directories.find( subdirectory ) == tree.directories.end() )
+      {
+        scanTree( subdirectory, tree );
+      }
+    }
+    else if ( tree.directories.find( subdirectory ) != tree.directories.end() )
+    {
+      removeTree( subdirectory );
+    }
+
+    auto const file =
+      std::find_if( files.begin(), files.end(), [ &name ]( File const & it ) {
+        return it.name == name;
+      } );
+
+    if ( exists && S_ISREG( info.st_mode ) )
+    {
+      auto & entry = file == files.end() ? files.emplace_back() : *file;
+
+      entry.name = name;
+      entry.size = static_cast< std::uint64_t >( info.st_size );
+      entry.modified = modifiedTime( info );
+    }
+    else if ( file != files.end() ) { files.erase( file ); }
+
+    directoryModified( fullPath( directory ), contents->second.modified );
+  }
+
+  inline int DirectoryIndex::watchDirectory( std::string const & directory,
+                                            Tree & into )
+  {
+    if ( inotifyDescriptor < 0 ) { return 0; }
+
+    auto const descriptor = ::inotify_add_watch(
+      inotifyDescriptor,
+      fullPath( directory ).c_str(),
+      IN_CREATE | IN_DELETE | IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE |
+        IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR );
+
+    if ( descriptor < 0 ) { return errno; }
+    into.watchedDirectories.emplace( descriptor, directory );
+    into.watchDescriptors[ directory ] = descriptor;
+    return 0;
+  }
+
+  inline void DirectoryIndex::unwatchDirectory( std::string const & directory,
+                                               Tree & from )
+  {
+    auto const it = from.watchDescriptors.find( directory );
+
+    if ( it == from.watchDescriptors.end() ) { return; }
+
+    auto const descriptor = it->second;
+    auto const watched = from.watchedDirectories.equal_range( descriptor );
+
+    auto const entry = std::find_if(
+      watched.first, watched.second, [ &directory ]( auto const & it ) {
+        return it.second == directory;
+      } );
+
+    if ( entry != watched.second ) { from.watchedDirectories.erase( entry ); }
+    from.watchDescriptors.erase( it );
+
+    // A watch is kept while a linked directory still shares it, and a new
+    // tree shares watch descriptors with the snapshot, whose watches must be
+    // kept until replaceTree swaps the trees.
+    if ( from.watchedDirectories.count( descriptor ) == 0 &&
+         ( &from == &tree || tree.watchedDirectories.count( descriptor ) ==
+                               0 ) )
+    {
+      ::inotify_rm_watch( inotifyDescriptor, descriptor );
+    }
+  }
+
+  inline void DirectoryIndex::startWatching()
+  {
+    if ( inotifyDescriptor >= 0 )
+    {
+      watcher = std::thread( &DirectoryIndex::watchLoop, this );
+    }
+  }
+
+  inline void DirectoryIndex::watchLoop()
+  {
+    alignas( struct inotify_event ) char buffer[ 64 * 1024 ];
+    struct pollfd descriptors[ 2 ] = { { inotifyDescriptor, POLLIN, 0 },
+                                       { stopDescriptor, POLLIN, 0 } };
+
+    while ( true )
+    {
+      if ( ::poll( descriptors, 2, -1 ) < 0 )
+      {
+        if ( errno == EINTR ) { continue; }
+        perror( "Directory watcher stopped." );
+        return;
+      }
+      if ( descriptors[ 1 ].revents != 0 ) { return; }
+
+      auto const length = ::read( inotifyDescriptor, buffer, sizeof( buffer ) );
+
+      if ( length <= 0 ) { continue; }
+
+      // Entries changed several times in one batch are only updated once.
+      std::set< std::pair< std::string, std::string > > changes;
+      bool overflowed = false;
+      std::lock_guard< std::mutex > updateGuard( updateLock );
+      std::unique_lock< std::shared_mutex > guard( lock );
+
+      for ( auto position = buffer; position < buffer + length; )
+      {
+        auto const event =
+          reinterpret_cast< struct inotify_event const * >( position );
+        position += sizeof( struct inotify_event ) + event->len;
+
+        if ( event->mask & IN_Q_OVERFLOW )
+        {
+          overflowed = true;
+          continue;
+        }
+
+        auto const watched = tree.watchedDirectories.equal_range( event->wd );
+
+        if ( event->mask & IN_IGNORED )
+        {
+          for ( auto it = watched.first; it != watched.second; ++it )
+          {
+            auto const descriptor = tree.watchDescriptors.find( it->second );
+
+            if ( descriptor != tree.watchDescriptors.end() &&
+                 descriptor->second == event->wd )
+            {
+              tree.watchDescriptors.erase( descriptor );
+            }
+          }
+          tree.watchedDirectories.erase( watched.first, watched.second );
+        }
+        else if ( event->len > 0 )
+        {
+          for ( auto it = watched.first; it != watched.second; ++it )
+          {
+            changes.emplace( it->second, event->name );
+          }
+        }
+      }
+
+      // Dropped notifications leave no way to know what changed.
+      if ( overflowed )
+      {
+        guard.unlock();
+        replaceTree();
+      }
+      else
+      {
+        for ( auto const & it : changes )
+        {
+          updateEntry( it.first, it.second );
+        }
+      }
+    }
+  }
+#endif
+
+  inline char const * operationName( IOOperation const & operation )
+  {
+    switch ( operation )
+    {
+      case IOOperation::ReadLine: return "readLine";
+      case IOOperation::WriteLine: return "writeLine";
+      case IOOperation::ReadFile: return "readFile";
+      case IOOperation::Open: return "open";
+      case IOOperation::Close: return "close";
+      case IOOperation::FindFiles: return "findFiles";
+    }
+    return "unknown";
+  }
+
+  inline std::string quoteJSON( std::string_view const & str )
+  {
+    std::string quoted = "\"";
+
+    for ( auto const & it : str )
+    {
+      if ( it == '"' || it == '\\' )
+      {
+        quoted += '\\';
+        quoted += it;
+      }
+      else if ( static_cast< unsigned char >( it ) < 0x20 )
+      {
+        char escaped[ 8 ];
+
+        std::snprintf( escaped, sizeof( escaped ), "\\u%04x", it );
+        quoted += escaped;
+      }
+      else { quoted += it; }
+    }
+    return quoted + '"';
+  }
+
+  inline void LatencyHistogram::record( std::uint64_t const & nanoseconds )
+  {
+    std::size_t bucket = 0;
+
+    for ( auto remaining = nanoseconds; remaining; remaining >>= 1 )
+    {
+      ++bucket;
+    }
+    ++buckets[ bucket ];
+    ++count;
+    totalNanoseconds += nanoseconds;
+  }
+
+  inline void LatencyHistogram::merge( LatencyHistogram const & other )
+  {
+    for ( std::size_t i = 0; i < BucketCount; ++i )
+    {
+      buckets[ i ] += other.buckets[ i ];
+    }
+    count += other.count;
+    totalNanoseconds += other.totalNanoseconds;
+  }
+
+  inline std::uint64_t LatencyHistogram::percentile(
+    double const & percent ) const
+  {
+    auto const rank = static_cast< std::uint64_t >(
+      std::ceil( std::clamp( percent, 0.0, 100.0 ) / 100.0 * count ) );
+    std::uint64_t seen = 0;
+
+    for ( std::size_t i = 0; i < BucketCount && count > 0; ++i )
+    {
+      seen += buckets[ i ];
+      if ( seen >= std::max< std::uint64_t >( rank, 1 ) )
+      {
+        if ( i == 0 ) { return 0; }
+        return i < 64 ? std::uint64_t( 1 ) << i : UINT64_MAX;
+      }
+    }
+    return 0;
+  }
+
+  inline void PathStats::merge( PathStats const & other )
+  {
+    bytesRead += other.bytesRead;
+    bytesWritten += other.bytesWritten;
+    readLineCalls += other.readLineCalls;
+    writeLineCalls += other.writeLineCalls;
+    readFileCalls += other.readFileCalls;
+    opens += other.opens;
+    closes += other.closes;
+    findFilesCalls += other.findFilesCalls;
+    directoriesVisited += other.directoriesVisited;
+    entriesStatted += other.entriesStatted;
+  }
+
+  inline LatencyHistogram const & IOStats::latency(
+    IOOperation const & operation ) const
+  {
+    return latencies[ static_cast< std::size_t >( operation ) ];
+  }
+
+  inline std::string IOStats::toJSON() const
+  {
+    std::ostringstream json;
+
+    json << "{ \"enabled\": " << ( enabled ? "true" : "false" )
+         << ", \"operations\": {";
+    for ( std::size_t i = 0; i < IOOperationCount; ++i )
+    {
+      auto const & histogram = latencies[ i ];
+
+      json << ( i ? ", " : " " )
+           << quoteJSON( operationName( IOOperation( i ) ) )
+           << ": { \"count\": " << histogram.count
+           << ", \"total_ns\": " << histogram.totalNanoseconds
+           << ", \"mean_ns\": "
+           << ( histogram.count ? histogram.totalNanoseconds / histogram.count
+                                : 0 )
+           << ", \"p50_ns\": " << histogram.percentile( 50 )
+           << ", \"p90_ns\": " << histogram.percentile( 90 )
+           << ", \"p99_ns\": " << histogram.percentile( 99 ) << " }";
+    }
+    json << " }, \"paths\": {";
+
+    auto separator = " ";
+
+    for ( auto const & it : paths )
+    {
+      auto const & stats = it.second;
+
+      json << separator << quoteJSON( it.first ) << ": { \"ids\": [";
+      for ( std::size_t i = 0; i < stats.IDs.size(); ++i )
+      {
+        json << ( i ? ", " : " " ) << quoteJSON( stats.IDs[ i ] )
+             << ( i + 1 == stats.IDs.size() ? " " : "" );
+      }
+      json << "], \"bytes_read\": " << stats.bytesRead
+           << ", \"bytes_written\": " << stats.bytesWritten
+           << ", \"read_line_calls\": " << stats.readLineCalls
+           << ", \"write_line_calls\": " << stats.writeLineCalls
+           << ", \"read_file_calls\": " << stats.readFileCalls
+           << ", \"opens\": " << stats.opens << ", \"closes\": " << stats.closes
+           << ", \"find_files_calls\": " << stats.findFilesCalls
+           << ", \"directories_visited\": " << stats.directoriesVisited
+           << ", \"entries_statted\": " << stats.entriesStatted << " }";
+      separator = ", ";
+    }
+    json << ( paths.empty() ? "}" : " }" ) << " }";
+    return json.str();
+  }
+
+  inline std::string IOStats::toText() const
+  {
+    std::ostringstream text;
+
+    text << "I/O statistics, recording " << ( enabled ? "on" : "off" )
+         << "\noperation    count    mean ns     p50 ns     p90 ns     p99 ns";
+    for ( std::size_t i = 0; i < IOOperationCount; ++i )
+    {
+      auto const & histogram = latencies[ i ];
+
+      text << '\n'
+           << std::left << std::setw( 10 ) << operationName( IOOperation( i ) )
+           << std::right << std::setw( 8 ) << histogram.count
+           << std::setw( 11 )
+           << ( histogram.count ? histogram.totalNanoseconds / histogram.count
+                                : 0 )
+           << std::setw( 11 ) << histogram.percentile( 50 ) << std::setw( 11 )
+           << histogram.percentile( 90 ) << std::setw( 11 )
+           << histogram.percentile( 99 );
+    }
+    for ( auto const & it : paths )
+    {
+      auto const & stats = it.second;
+
+      text << "\n" << it.first;
+      for ( auto const & ID : stats.IDs ) { text << " [" << ID << "]"; }
+      text << "\n  read " << stats.bytesRead << " B, written "
+           << stats.bytesWritten << " B, readLine " << stats.readLineCalls
+           << ", writeLine " << stats.writeLineCalls << ", readFile "
+           << stats.readFileCalls << ", open " << stats.opens << ", close "
+           << stats.closes << ", findFiles " << stats.findFilesCalls
+           << ", directories " << stats.directoriesVisited << ", stat'ed "
+           << stats.entriesStatted;
+    }
+    return text.str() + '\n';
+  }
+
+#ifdef FIO_ENABLE_STATS
+  inline IOStatsRecorder::Scope::Scope( IOStatsRecorder & recorder,
+                                        hst::hstring const & path,
+                                        IOOperation const & operation ) :
+    recorder( recorder.enabled() ? &recorder : nullptr ),
+    path( path ),
+    operation( operation )
+  {
+    if ( this->recorder ) { start = Clock::now(); }
+  }
+
+  inline IOStatsRecorder::Scope::~Scope()
+  {
+    if ( ! recorder ) { return; }
+
+    auto const elapsed = std::chrono::duration_cast< std::chrono::nanoseconds >(
+      Clock::now() - start );
+    auto const & key = path.str();
+    auto & block = recorder->threadBlock();
+    std::lock_guard< std::mutex > guard( block.lock );
+    auto & stats = block.paths[ key ];
+
+    stats.bytesRead += bytesRead;
+    stats.bytesWritten += bytesWritten;
+    stats.directoriesVisited += directoriesVisited;
+    stats.entriesStatted += entriesStatted;
+    switch ( operation )
+    {
+      case IOOperation::ReadLine: ++stats.readLineCalls; break;
+      case IOOperation::WriteLine: ++stats.writeLineCalls; break;
+      case IOOperation::ReadFile: ++stats.readFileCalls; break;
+      case IOOperation::Open: ++stats.opens; break;
+      case IOOperation::Close: ++stats.closes; break;
+      case IOOperation::FindFiles: ++stats.findFilesCalls; break;
+    }
+    block.latencies[ static_cast< std::size_t >( operation ) ].record(
+      elapsed.count() );
+  }
+
+  inline IOStatsRecorder::IOStatsRecorder() : recorderID( newRecorderID() ) {}
+
+  inline IOStatsRecorder::~IOStatsRecorder()
+  {
+    std::lock_guard< std::mutex > guard( blocksLock );
+
+    for ( auto const & block : blocks )
+    {
+      std::lock_guard< std::mutex > blockGuard( block->lock );
+
+      std::unordered_map< std::string, PathStats >().swap( block->paths );
+      block->orphaned = true;
+    }
+  }
+
+  inline void IOStatsRecorder::enable( bool const & enable )
+  {
+    recording.store( enable, std::memory_order_relaxed );
+  }
+
+  inline IOStats IOStatsRecorder::snapshot() const
+  {
+    std::lock_guard< std::mutex > guard( blocksLock );
+    auto stats = exitedThreads;
+
+    stats.enabled = enabled();
+    for ( auto const & block : blocks )
+    {
+      std::lock_guard< std::mutex > blockGuard( block->lock );
+
+      mergeBlock( stats, *block );
+    }
+    return stats;
+  }
+
+  inline void IOStatsRecorder::reset()
+  {
+    std::lock_guard< std::mutex > guard( blocksLock );
+
+    exitedThreads = IOStats();
+    for ( auto const & block : blocks )
+    {
+      std::lock_guard< std::mutex > blockGuard( block->lock );
+
+      block->paths.clear();
+      block->latencies = {};
+    }
+  }
+
+  inline IOStatsRecorder::ThreadBlock & IOStatsRecorder::threadBlock()
+  {
+    // The calling thread's blocks, by recorder. The blocks of destroyed
+    // recorders are dropped whenever the thread adds a block.
+    thread_local std::unordered_map< std::uint64_t,
+                                     std::shared_ptr< ThreadBlock > >
+      threadBlocks;
+    auto const found = threadBlocks.find( recorderID );
+
+    if ( found != threadBlocks.end() ) { return *found->second; }
+
+    for ( auto it = threadBlocks.begin(); it != threadBlocks.end(); )
+    {
+      if ( it->second->orphaned ) { it = threadBlocks.erase( it ); }
+      else { ++it; }
+    }
+
+    auto const block = std::make_shared< ThreadBlock >();
+    std::lock_guard< std::mutex > guard( blocksLock );
+
+    // Looking only once the list has doubled keeps adding blocks amortized
+    // constant time.
+    if ( blocks.size() >= pruneSize )
+    {
+      pruneBlocks();
+      pruneSize = std::max( MinPruneSize, 2 * blocks.size() );
+    }
+    blocks.push_back( block );
+    threadBlocks.emplace( recorderID, block );
+    return *block;
+  }
+
+  inline void IOStatsRecorder::pruneBlocks()
+  {
+    auto const exited = std::remove_if(
+      blocks.begin(),
+      blocks.end(),
+      [ this ]( std::shared_ptr< ThreadBlock > const & block ) {
+        if ( block.use_count() != 1 ) { return false; }
+
+        std::lock_guard< std::mutex > blockGuard( block->lock );
+
+        mergeBlock( exitedThreads, *block );
+        return true;
+      } );
+
+    blocks.erase( exited, blocks.end() );
+  }
+
+  inline void IOStatsRecorder::mergeBlock( IOStats & stats,
+                                           ThreadBlock const & block )
+  {
+    for ( auto const & it : block.paths )
+    {
+      stats.paths[ it.first ].merge( it.second );
+    }
+    for ( std::size_t i = 0; i < IOOperationCount; ++i )
+    {
+      stats.latencies[ i ].merge( block.latencies[ i ] );
+    }
+  }
+
+  inline std::uint64_t IOStatsRecorder::newRecorderID()
+  {
+    static std::atomic< std::uint64_t > recorders{ 0 };
+
+    return ++recorders;
+  }
+#endif
+
+  inline FIO::FIO( hst::hstring const & loc /* = "" */ )
+  {
+    if ( ! setlocale( LC_ALL, loc.mb_str() ) )
+    {
+      throw std::runtime_error(
+        ( "Could not set locale to: \"" + loc + "\"!" ).mb_str() );
+    }
+    setRootDir( findRootDir() );
+  }
+
+  inline FIO & FIO::clear()
+  {
+    // The root dir is kept in the same update, so concurrent lookups of
+    // "__root" never see it missing.
+    updatePathMap( []( PathMap & paths ) {
+      auto const root = paths[ L"__root" ];
+
+      paths.clear();
+      paths[ L"__root" ] = root;
+    } );
+    {
+      std::lock_guard< std::mutex > guard( directoryIndexLock );
+      directoryIndexes.clear();
+    }
+    for ( auto const & it : paths.handles() )
+    {
+      closeInputStream( it );
+      closeOutputStream( it );
+    }
+    paths.prune();
+
+    return *this;
+  }
+
+  inline PathHandle FIO::getHandle( hst::hstring const & pathOrID )
+  {
+    return paths.intern( getPath( pathOrID ) );
+  }
+
+  inline std::wistream & FIO::openInputStream( hst::hstring const & pathOrID )
+  {
+    return openInputStream( getHandle( pathOrID ) );
+  }
+
+  inline std::wistream & FIO::openInputStream( PathHandle const & handle )
+  {
+    if ( handle )
+    {
+      auto & slot = *handle.slot;
+      IOStatsRecorder::Scope scope(
+        statsRecorder, slot.path, IOOperation::Open );
+      std::lock_guard< std::mutex > guard( slot.lock );
+
+      if ( ! std::atomic_load( &slot.input ) )
+      {
+        std::atomic_store(
+          &slot.input,
+          std::make_shared< InputEntry >( slot.path, std::wifstream::in ) );
+      }
+    }
+    return validateInputStream( handle )->stream;
+  }
+
+  inline std::wostream & FIO::openOutputStream(
+    hst::hstring const & pathOrID,
+    bool const & appendToFile /* = OpenNewFile */ )
+  {
+    return openOutputStream( getHandle( pathOrID ), appendToFile );
+  }
+
+  inline std::wostream & FIO::openOutputStream(
+    PathHandle const & handle,
+    bool const & appendToFile /* = OpenNewFile */ )
+  {
+    if ( handle )
+    {
+      auto & slot = *handle.slot;
+      IOStatsRecorder::Scope scope(
+        statsRecorder, slot.path, IOOperation::Open );
+      std::lock_guard< std::mutex > guard( slot.lock );
+
+      if ( std::atomic_load( &slot.buffered ) )
+      {
+        throw std::runtime_error(
+          ( L"Could not open output stream \"" + slot.path +
+            L"\". A buffered output stream is already open on it." )
+            .mb_str() );
+      }
+      if ( ! std::atomic_load( &slot.output ) )
+      {
+        std::atomic_store(
+          &slot.output,
+          std::make_shared< OutputEntry >(
+            slot.path,
+            ( appendToFile ? std::wofstream::app : std::wofstream::out ) ) );
+      }
+    }
+    return validateOutputStream( handle )->stream;
+  }
+
+  inline BufferedWriter & FIO::openBufferedOutputStream(
+    hst::hstring const & pathOrID,
+    bool const & appendToFile /* = OpenNewFile */ )
+  {
+    return openBufferedOutputStream( getHandle( pathOrID ), appendToFile );
+  }
+
+  inline BufferedWriter & FIO::openBufferedOutputStream(
+    PathHandle const & handle,
+    bool const & appendToFile /* = OpenNewFile */ )
+  {
+    if ( ! handle ) { validateOutputStream( handle ); }
+
+    auto & slot = *handle.slot;
+    IOStatsRecorder::Scope scope(
+      statsRecorder, slot.path, IOOperation::Open );
+    std::lock_guard< std::mutex > guard( slot.lock );
+    auto writer = std::atomic_load( &slot.buffered );
+
+    if ( std::atomic_load( &slot.output ) )
+    {
+      throw std::runtime_error(
+        ( L"Could not open buffered output stream \"" + slot.path +
+          L"\". A wide output stream is already open on it." )
+          .mb_str() );
+    }
+    if ( ! writer )
+    {
+      writer = std::make_shared< BufferedEntry >( slot.path, appendToFile );
+      writer->stream.statsRecorder = &statsRecorder;
+      std::atomic_store( &slot.buffered, writer );
+    }
+    return writer->stream;
+  }
+
+  inline std::wistream & FIO::rewindInputStream( hst::hstring const & pathOrID )
+  {
+    auto const path = getPath( pathOrID );
+
+    return rewindInputStream( validateInputStream( paths.find( path ),
+                                                   path ) );
+  }
+
+  inline std::wistream & FIO::rewindInputStream( PathHandle const & handle )
+  {
+    return rewindInputStream( validateInputStream( handle ) );
+  }
+
+  inline std::wistream & FIO::rewindInputStream(
+    LockedEntry< InputEntry > const & entry )
+  {
+    entry->stream.clear();
+    return entry->stream.seekg( 0, std::ios::beg );
+  }
+
+  inline FIO & FIO::closeInputStream( hst::hstring const & pathOrID )
+  {
+    auto const path = getPath( pathOrID );
+
+    closeInputStream( paths.find( path ) );
+    paths.release( path );
+    return *this;
+  }
+
+  inline FIO & FIO::closeInputStream( PathHandle const & handle )
+  {
+    if ( handle )
+    {
+      IOStatsRecorder::Scope scope(
+        statsRecorder, handle.slot->path, IOOperation::Close );
+      std::shared_ptr< InputEntry > removed;
+      std::lock_guard< std::mutex > guard( handle.slot->lock );
+
+      removed = std::atomic_exchange( &handle.slot->input, removed );
+      markClosed( removed );
+    }
+    return *this;
+  }
+
+  inline FIO & FIO::closeOutputStream( hst::hstring const & pathOrID )
+  {
+    auto const path = getPath( pathOrID );
+
+    closeOutputStream( paths.find( path ) );
+    paths.release( path );
+    return *this;
+  }
+
+  inline FIO & FIO::closeOutputStream( PathHandle const & handle )
+  {
+    if ( handle )
+    {
+      IOStatsRecorder::Scope scope(
+        statsRecorder, handle.slot->path, IOOperation::Close );
+      std::shared_ptr< OutputEntry > removedOutput;
+      std::shared_ptr< BufferedEntry > removedBuffered;
+      std::lock_guard< std::mutex > guard( handle.slot->lock );
+
+      removedOutput =
+        std::atomic_exchange( &handle.slot->output, removedOutput );
+      removedBuffered =
+        std::atomic_exchange( &handle.slot->buffered, removedBuffered );
+      markClosed( removedOutput );
+      markClosed( removedBuffered );
+    }
+    return *this;
+  }
+
+  inline FIO & FIO::flushOutputStream( hst::hstring const & pathOrID )
+  {
+    auto const path = getPath( pathOrID );
+    auto const handle = paths.find( path );
+
+    if ( handle ) { return flushOutputStream( handle ); }
+    validateOutputStream( handle, path );
+    return *this;
+  }
+
+  inline FIO & FIO::flushOutputStream( PathHandle const & handle )
+  {
+    if ( auto const writer = bufferedEntry( handle ) )
+    {
+      std::shared_lock< std::shared_mutex > guard( writer->lock );
+
+      if ( ! writer->closed )
+      {
+        writer->stream.flush();
+        return *this;
+      }
+    }
+    validateOutputStream( handle )->stream.flush();
+    return *this;
+  }
+
+  inline FIO & FIO::syncOutputStream( hst::hstring const & pathOrID )
+  {
+    auto const path = getPath( pathOrID );
+    auto const handle = paths.find( path );
+
+    if ( handle ) { return syncOutputStream( handle ); }
+    validateOutputStream( handle, path );
+    return *this;
+  }
+
+  inline FIO & FIO::syncOutputStream( PathHandle const & handle )
+  {
+    if ( auto const writer = bufferedEntry( handle ) )
+    {
+      std::shared_lock< std::shared_mutex > guard( writer->lock );
+
+      if ( ! writer->closed )
+      {
+        writer->stream.sync();
+        return *this;
+      }
+    }
+    return flushOutputStream( handle );
+  }
+
+  inline bool FIO::hasInputStream( hst::hstring const & pathOrID )
+  {
+    return hasInputStream( paths.find( getPath( pathOrID ) ) );
+  }
+
+  inline bool FIO::hasInputStream( PathHandle const & handle )
+  {
+    return handle && std::atomic_load( &handle.slot->input ) != nullptr;
+  }
+
+  inline bool FIO::hasOutputStream( hst::hstring const & pathOrID )
+  {
+    return hasOutputStream( paths.find( getPath( pathOrID ) ) );
+  }
+
+  inline bool FIO::hasOutputStream( PathHandle const & handle )
+  {
+    return handle && ( std::atomic_load( &handle.slot->output ) != nullptr ||
+                       std::atomic_load( &handle.slot->buffered ) != nullptr );
+  }
+
+  inline std::wistream & FIO::getInputStream(
+    hst::hstring const & pathOrID ) const
+  {
+    auto const path = getPath( pathOrID );
+
+    return validateInputStream( paths.find( path ), path )->stream;
+  }
+
+  inline std::wistream & FIO::getInputStream( PathHandle const & handle ) const
+  {
+    return validateInputStream( handle )->stream;
+  }
+
+  inline std::wostream & FIO::getOutputStream(
+    hst::hstring const & pathOrID ) const
+  {
+    auto const path = getPath( pathOrID );
+
+    return validateOutputStream( paths.find( path ), path )->stream;
+  }
+
+  inline std::wostream & FIO::getOutputStream(
+    PathHandle const & handle ) const
+  {
+    return validateOutputStream( handle )->stream;
+  }
+
+  inline BufferedWriter & FIO::getBufferedOutputStream(
+    hst::hstring const & pathOrID ) const
+  {
+    auto const path = getPath( pathOrID );
+
+    return validateBufferedOutputStream( paths.find( path ), path )->stream;
+  }
+
+  inline BufferedWriter & FIO::getBufferedOutputStream(
+    PathHandle const & handle ) const
+  {
+    return validateBufferedOutputStream( handle )->stream;
+  }
+
+  inline hst::hstring FIO::readLine( hst::hstring const & pathOrID )
+  {
+    auto const path = getPath( pathOrID );
+    auto const entry = validateInputStream( paths.find( path ), path );
+    IOStatsRecorder::Scope scope(
+      statsRecorder, path, IOOperation::ReadLine );
+    auto line = readLine( entry );
+
+    scope.addBytesRead( line.wstr().size() );
+    return line;
+  }
+
+  inline hst::hstring FIO::readLine( PathHandle const & handle )
+  {
+    auto const entry = validateInputStream( handle );
+    IOStatsRecorder::Scope scope(
+      statsRecorder, handle.slot->path, IOOperation::ReadLine );
+    auto line = readLine( entry );
+
+    scope.addBytesRead( line.wstr().size() );
+    return line;
+  }
+
+  inline hst::hstring FIO::readLine( LockedEntry< InputEntry > const & entry )
+  {
+    std::wstring line;
+
+    std::getline( entry->stream, line );
+    return line;
+  }
+
+  inline FIO & FIO::writeLine( hst::hstring const & pathOrID,
+                               hst::hstring const & source )
+  {
+    auto const path = getPath( pathOrID );
+    auto const handle = paths.find( path );
+
+    if ( handle ) { return writeLine( handle, source ); }
+    validateOutputStream( handle, path );
+    return *this;
+  }
+
+  inline FIO & FIO::writeLine( PathHandle const & handle,
+                               hst::hstring const & source )
+  {
+    if ( auto const writer = bufferedEntry( handle ) )
+    {
+      std::shared_lock< std::shared_mutex > guard( writer->lock );
+
+      // The writer records its own writes.
+      if ( ! writer->closed )
+      {
+        writer->stream.write( source.str() );
+        return *this;
+      }
+    }
+
+    auto const entry = validateOutputStream( handle );
+    IOStatsRecorder::Scope scope(
+      statsRecorder, handle.slot->path, IOOperation::WriteLine );
+
+    entry->stream << source;
+    scope.addBytesWritten( source.wstr().size() );
+    return *this;
+  }
+
+  inline std::shared_ptr< FIO::BufferedEntry > FIO::bufferedEntry(
+    PathHandle const & handle ) const
+  {
+    if ( ! handle ) { return nullptr; }
+    return std::atomic_load( &handle.slot->buffered );
+  }
+
+#ifdef WINDOWS
+  #ifndef PATH_SEP
+    // Windows-style path separator
+    #define PATH_SEP hst::hstring( L"\\" )
+  #endif
+#else
+  #ifndef PATH_SEP
+    // Unix-style path separator
+    #define PATH_SEP hst::hstring( L"/" )
+  #endif
+#endif
+
+  inline std::vector< hst::hstring > FIO::findFiles(
+    hst::hstring const & fileExtension /* = L".*" */,
+    hst::hstring const & pathOrID /* = L"__root" */,
+    bool const & recursiveSearch /* = RecursiveSearchTrue */ ) const
+  {
+    auto const path = getPath( pathOrID );
+    IOStatsRecorder::Scope scope(
+      statsRecorder, path, IOOperation::FindFiles );
+
+    if ( auto const index = findDirectoryIndex( path ) )
+    {
+      return index->findFiles( fileExtension, recursiveSearch );
+    }
+
+    std::vector< hst::hstring > foundFiles;
+
+    searchFiles(
+      fileExtension,
+      pathOrID,
+      recursiveSearch,
+      [ &foundFiles ]( std::vector< NativePath > && files ) {
+        for ( auto & it : files ) { foundFiles.push_back( std::move( it ) ); }
+      },
+      scope );
+    return foundFiles;
+  }
+
+  inline std::size_t FIO::findFiles(
+    FileCallback const & onFileFound,
+    hst::hstring const & fileExtension /* = L".*" */,
+    hst::hstring const & pathOrID /* = L"__root" */,
+    bool const & recursiveSearch /* = RecursiveSearchTrue */ ) const
+  {
+    auto const path = getPath( pathOrID );
+    IOStatsRecorder::Scope scope(
+      statsRecorder, path, IOOperation::FindFiles );
+
+    if ( auto const index = findDirectoryIndex( path ) )
+    {
+      return index->findFiles( onFileFound, fileExtension, recursiveSearch );
+    }
+
+    std::size_t fileCount = 0;
+
+    searchFiles(
+      fileExtension,
+      pathOrID,
+      recursiveSearch,
+      [ &fileCount, &onFileFound ]( std::vector< NativePath > && files ) {
+        for ( auto & it : files )
+        {
+          onFileFound( hst::hstring( std::move( it ) ) );
+        }
+        fileCount += files.size();
+      },
+      scope );
+    return fileCount;
+  }
+
+  inline DirectoryIndex & FIO::indexDirectory(
+    hst::hstring const & pathOrID,
+    bool const & watchChanges /* = WatchChangesTrue */ )
+  {
+    auto const path = getPath( pathOrID );
+    auto const index = std::make_shared< DirectoryIndex >( path, watchChanges );
+    std::lock_guard< std::mutex > guard( directoryIndexLock );
+
+    return *( directoryIndexes[ directoryKey( path ) ] = index );
+  }
+
+  inline DirectoryIndex & FIO::loadDirectoryIndex(
+    hst::hstring const & pathOrID,
+    hst::hstring const & pathToIndex,
+    bool const & watchChanges /* = WatchChangesTrue */ )
+  {
+    auto const path = getPath( pathOrID );
+    std::shared_ptr< DirectoryIndex > const index =
+      DirectoryIndex::load( pathToIndex, watchChanges );
+
+    auto const root = index->rootDirectory();
+
+    if ( directoryKey( path ) != directoryKey( root ) )
+    {
+      throw std::runtime_error( ( L"Directory index \"" + pathToIndex +
+                                  L"\" was saved from \"" + root +
+                                  L"\", not \"" + path + L"\"." )
+                                  .mb_str() );
+    }
+    std::lock_guard< std::mutex > guard( directoryIndexLock );
+
+    return *( directoryIndexes[ directoryKey( path ) ] = index );
+  }
+
+  inline FIO & FIO::removeDirectoryIndex( hst::hstring const & pathOrID )
+  {
+    std::lock_guard< std::mutex > guard( directoryIndexLock );
+
+    directoryIndexes.erase( directoryKey( getPath( pathOrID ) ) );
+    return *this;
+  }
+
+  inline std::wstring FIO::directoryKey( hst::hstring const & directory )
+  {
+    auto key = directory.wstr();
+
+    while ( key.size() > 1 && ( key.back() == L'/' || key.back() == L'\\' ) )
+    {
+      key.pop_back();
+    }
+    return key;
+  }
+
+  inline std::shared_ptr< DirectoryIndex > FIO::findDirectoryIndex(
+    hst::hstring const & directory ) const
+  {
+    std::lock_guard< std::mutex > guard( directoryIndexLock );
+    auto const it = directoryIndexes.find( directoryKey( directory ) );
+
+    // A degraded index may have missed changes, so the disk is read instead.
+    if ( it == directoryIndexes.end() || it->second->degraded() )
+    {
+      return nullptr;
+    }
+    return it->second;
+  }
+
+  inline void FIO::searchFiles(
+    hst::hstring const & fileExtension,
+    hst::hstring const & pathOrID,
+    bool const & recursiveSearch,
+    FilesFoundCallback const & onFilesFound,
+    IOStatsRecorder::Scope & scope ) const
+  {
+    FileSearch search( fileExtension, recursiveSearch );
+
+#ifdef WINDOWS
+    searchDirectory( search, getPath( pathOrID ).wstr() );
+#else
+    searchDirectory( search, getPath( pathOrID ).str() );
+#endif
+    search.foundFiles.drain( search.group, onFilesFound );
+#ifdef FIO_ENABLE_STATS
+    scope.addDirectoriesVisited( search.directoriesVisited );
+    scope.addEntriesStatted( search.entriesStatted );
+#endif
+  }
+
+  inline void FIO::searchDirectory( FileSearch & search,
+                                    NativePath const & directory )
+  {
+    std::vector< NativePath > foundFiles;
+
+#ifdef WINDOWS
+    WIN32_FIND_DATAW info;
+    HANDLE dirHandle = ::FindFirstFileExW( ( directory + L"\\*" ).c_str(),
+                                           FindExInfoBasic,
+                                           &info,
+                                           FindExSearchNameMatch,
+                                           NULL,
+                                           FIND_FIRST_EX_LARGE_FETCH );
+
+    if ( dirHandle == INVALID_HANDLE_VALUE ) { return; }
+#ifdef FIO_ENABLE_STATS
+    ++search.directoriesVisited;
+#endif
+
+    do
+    {
+      std::wstring const fileName( info.cFileName );
+
+      if ( fileName == L"." || fileName == L".." ) { continue; }
+
+      auto filePath = directory + L"\\" + fileName;
+
+      if ( ! ( info.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY ) )
+      {
+        if ( search.filter.matches( hst::wideToMultiByte( fileName ) ) )
+        {
+          foundFiles.push_back( std::move( filePath ) );
+        }
+      }
+      else if ( search.recursiveSearch == RecursiveSearchTrue &&
+                ! ( info.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT ) )
+      {
+        search.group.run( [ &search, filePath ] {
+          searchDirectory( search, filePath );
+        } );
+      }
+    } while ( ::FindNextFileW( dirHandle, &info ) );
+    ::FindClose( dirHandle );
+#else
+    int const dirDescriptor =
+      ::open( directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC );
+
+    if ( dirDescriptor < 0 ) { return; }
+
+    DIR * const dirHandle = ::fdopendir( dirDescriptor );
+
+    if ( dirHandle == nullptr )
+    {
+      ::close( dirDescriptor );
+      return;
+    }
+#ifdef FIO_ENABLE_STATS
+    ++search.directoriesVisited;
+#endif
+
+    struct dirent * dirInfo;
+
+    while ( ( dirInfo = ::readdir( dirHandle ) ) != nullptr )
+    {
+      char const * const fileName = dirInfo->d_name;
+
+      if ( fileName[ 0 ] == '.' &&
+           ( fileName[ 1 ] == '\0' ||
+             ( fileName[ 1 ] == '.' && fileName[ 2 ] == '\0' ) ) )
+      {
+        continue;
+      }
+
+      auto isFile = dirInfo->d_type == DT_REG;
+      auto isDirectory = dirInfo->d_type == DT_DIR;
+
+      // Only stat entries whose type the directory listing does not give,
+      // and symbolic links, which are followed.
+      if ( dirInfo->d_type == DT_UNKNOWN || dirInfo->d_type == DT_LNK )
+      {
+        struct stat info;
+
+#ifdef FIO_ENABLE_STATS
+        ++search.entriesStatted;
+#endif
+        if ( ::fstatat( dirDescriptor, fileName, &info, 0 ) < 0 )
+        {
+          perror( "Invalid File encountered." );
+          continue;
+        }
+        isFile = S_ISREG( info.st_mode );
+        isDirectory = S_ISDIR( info.st_mode );
+
+        // Linked directories are only searched once, so cycles terminate.
+        if ( isDirectory && dirInfo->d_type == DT_LNK )
+        {
+          std::lock_guard< std::mutex > guard( search.lock );
+          isDirectory =
+            search.linkedDirectories.emplace( info.st_dev, info.st_ino ).second;
+        }
+      }
+
+      if ( isFile )
+      {
+        if ( search.filter.matches( fileName ) )
+        {
+          foundFiles.push_back( directory + '/' + fileName );
+        }
+      }
+      else if ( isDirectory && search.recursiveSearch == RecursiveSearchTrue )
+      {
+        search.group.run( [ &search, filePath = directory + '/' + fileName ] {
+          searchDirectory( search, filePath );
+        } );
+      }
+    }
+    ::closedir( dirHandle );
+#endif
+
+    if ( ! foundFiles.empty() )
+    {
+      search.foundFiles.push( std::move( foundFiles ) );
+    }
+  }
+
+  inline hst::hstring FIO::readFile( hst::hstring const & pathOrID )
+  {
+    auto const path = getPath( pathOrID );
+    IOStatsRecorder::Scope scope(
+      statsRecorder, path, IOOperation::ReadFile );
+
+    rewindOpenInputStream( path );
+
+    auto const file = mapFile( path );
+
+    scope.addBytesRead( file.size() );
+    return file.str();
+  }
+
+  inline std::vector< FileContents > FIO::readFiles(
+    std::vector< hst::hstring > const & pathsOrIDs,
+    std::size_t const & maxInFlight /* = DefaultReadsInFlight */ )
+  {
+    std::vector< FileContents > results( pathsOrIDs.size() );
+
+    readFiles( pathsOrIDs,
+               maxInFlight,
+               [ &results ]( std::size_t index, FileContents && result ) {
+                 results[ index ] = std::move( result );
+               } );
+    return results;
+  }
+
+  inline std::size_t FIO::readFiles(
+    FileContentsCallback const & onFileRead,
+    std::vector< hst::hstring > const & pathsOrIDs,
+    std::size_t const & maxInFlight /* = DefaultReadsInFlight */ )
+  {
+    return readFiles(
+      pathsOrIDs,
+      maxInFlight,
+      [ &onFileRead ]( std::size_t, FileContents && result ) {
+        onFileRead( std::move( result ) );
+      } );
+  }
+
+  inline std::vector< FileContents > FIO::readFiles(
+    hst::hstring const & fileExtension,
+    hst::hstring const & pathOrID,
+    bool const & recursiveSearch /* = RecursiveSearchTrue */,
+    std::size_t const & maxInFlight /* = DefaultReadsInFlight */ )
+  {
+    return readFiles( findFiles( fileExtension, pathOrID, recursiveSearch ),
+                      maxInFlight );
+  }
+
+  template < typename ResultSink >
+  inline std::size_t FIO::readFiles(
+    std::vector< hst::hstring > const & pathsOrIDs,
+    std::size_t const & maxInFlight,
+    ResultSink const & resultSink )
+  {
+    std::atomic< std::size_t > nextFile { 0 };
+    std::atomic< std::size_t > filesRead { 0 };
+    ResultQueue< std::pair< std::size_t, FileContents > > results;
+    TaskGroup group;
+
+    // Each reader takes the next unread file until none are left, so no
+    // more than maxInFlight files are ever read at once.
+    auto const readerCount =
+      std::min( std::max< std::size_t >( maxInFlight, 1 ), pathsOrIDs.size() );
+
+    for ( std::size_t i = 0; i < readerCount; ++i )
+    {
+      group.run( [ this, &pathsOrIDs, &nextFile, &filesRead, &results ] {
+        for ( auto index = nextFile++; index < pathsOrIDs.size();
+              index = nextFile++ )
+        {
+          FileContents result;
+
+          result.path = pathsOrIDs[ index ];
+          try
+          {
+            result.contents = readFile( result.path );
+            ++filesRead;
+          }
+          catch ( ... )
+          {
+            result.error = std::current_exception();
+          }
+          results.push( { index, std::move( result ) } );
+        }
+      } );
+    }
+    results.drain( group,
+                   [ &resultSink ](
+                     std::pair< std::size_t, FileContents > && result ) {
+                     resultSink( result.first, std::move( result.second ) );
+                   } );
+    return filesRead;
+  }
+
+  inline std::vector< hst::hstring > FIO::readFileToVector(
+    hst::hstring const & pathOrID, hst::hstring const & delim /* = L"\n\r" */ )
+  {
+    if ( ! hst::isByteSearchable( delim ) )
+    {
+      return splitString( readFile( pathOrID ), delim );
+    }
+
+    auto const path = getPath( pathOrID );
+    IOStatsRecorder::Scope scope(
+      statsRecorder, path, IOOperation::ReadFile );
+
+    rewindOpenInputStream( path );
+
+    auto const file = mapFile( path );
+    std::vector< hst::hstring > splitFile;
+
+    scope.addBytesRead( file.size() );
+    for ( auto const & it : Tokenizer( file.view(), delim.str() ) )
+    {
+      splitFile.push_back( std::string( it ) );
+    }
+    return splitFile;
+  }
+
+  inline RecordReader FIO::readRecords(
+    hst::hstring const & pathOrID, hst::hstring const & delim /* = L"\n\r" */ )
+  {
+    if ( ! hst::isByteSearchable( delim ) )
+    {
+      throw std::runtime_error(
+        ( L"Could not read records of \"" + pathOrID +
+          L"\". Record delimiters must be ASCII characters." )
+          .mb_str() );
+    }
+
+    auto const path = getPath( pathOrID );
+    // The records are read lazily, so only the call is counted.
+    IOStatsRecorder::Scope scope(
+      statsRecorder, path, IOOperation::ReadFile );
+
+    rewindOpenInputStream( path );
+    return RecordReader( path, delim.str() );
+  }
+
+  inline std::vector< std::vector< hst::hstring > > FIO::readFileToMatrix(
+    hst::hstring const & pathOrID,
+    hst::hstring const & lineDelim /* = L"," */,
+    hst::hstring const & vertDelim /* = L"\n\r" */ )
+  {
+    std::vector< std::vector< hst::hstring > > matrix;
+
+    if ( ! hst::isByteSearchable( lineDelim.wstr() + vertDelim.wstr() ) )
+    {
+      for ( auto const & it : readFileToVector( pathOrID, vertDelim ) )
+      {
+        auto const splitLine = splitString( it, lineDelim );
+
+        if ( splitLine.size() > 0 ) { matrix.push_back( splitLine ); }
+      }
+      return matrix;
+    }
+
+    auto const path = getPath( pathOrID );
+    IOStatsRecorder::Scope scope(
+      statsRecorder, path, IOOperation::ReadFile );
+
+    rewindOpenInputStream( path );
+
+    auto const file = mapFile( path );
+    DelimiterSet const lineDel( lineDelim.str() );
+
+    scope.addBytesRead( file.size() );
+    for ( auto const & line : Tokenizer( file.view(), vertDelim.str() ) )
+    {
+      std::vector< hst::hstring > splitLine;
+
+      for ( auto const & it : Tokenizer( line, lineDel ) )
+      {
+        splitLine.push_back( std::string( it ) );
+      }
+      if ( splitLine.size() > 0 )
+      {
+        matrix.push_back( std::move( splitLine ) );
+      }
+    }
+    return matrix;
+  }
+
+  inline MappedFile FIO::mapFile( hst::hstring const & pathOrID ) const
+  {
+    return MappedFile( getPath( pathOrID ) );
+  }
+
+  // Names a column type for parse error messages.
+  template < typename ValueType >
+  inline char const * columnTypeName()
+  {
+    if ( std::is_integral< ValueType >::value ) { return "an integer"; }
+    if ( std::is_floating_point< ValueType >::value ) { return "a number"; }
+    return "text";
+  }
+
+  /*
+    Parse one cell into the back of its column. Returns false if the cell is
+    not a valid value of the column's type.
+  */
+  template < typename ValueType >
+  inline bool parseCell( std::string_view cell,
+                         std::vector< ValueType > & column )
+  {
+    if constexpr ( std::is_same< ValueType, std::string >::value )
+    {
+      column.emplace_back( cell );
+      return true;
+    }
+    else
+    {
+      static_assert( std::is_arithmetic< ValueType >::value,
+                     "Columns must be arithmetic types or std::string." );
+
+      auto const first = cell.find_first_not_of( " \t" );
+      if ( first == std::string_view::npos ) { return false; }
+      cell = cell.substr( first, cell.find_last_not_of( " \t" ) - first + 1 );
+      if ( cell.size() > 1 && cell[ 0 ] == '+' && cell[ 1 ] != '-' )
+      {
+        cell.remove_prefix( 1 );
+      }
+
+      ValueType value;
+      auto const result =
+        std::from_chars( cell.data(), cell.data() + cell.size(), value );
+
+      if ( result.ec != std::errc() ||
+           result.ptr != cell.data() + cell.size() )
+      {
+        return false;
+      }
+      column.push_back( value );
+      return true;
+    }
+  }
+
+  /*
+    Split source into rows and cells, and parse each row into a Columns
+    object with parseRow. Sources over a megabyte are cut into chunks just
+    after row delimiters, which are parsed in parallel into separate Columns
+    objects and then joined in order with appendColumns.
+    parseRow( columns, cells, failedColumn ) returns false and sets
+    failedColumn if a cell could not be parsed; describeFailure( column )
+    names the expected type of a column for the error message.
+  */
+  template < typename Columns,
+             typename MakeColumns,
+             typename ParseRow,
+             typename AppendColumns,
+             typename DescribeFailure >
+  inline Columns parseColumns( std::string_view const & source,
+                               hst::hstring const & sourceName,
+                               std::size_t const & columnCount,
+                               hst::hstring const & lineDelim,
+                               hst::hstring const & vertDelim,
+                               MakeColumns const & makeColumns,
+                               ParseRow const & parseRow,
+                               AppendColumns const & appendColumns,
+                               DescribeFailure const & describeFailure )
+  {
+    if ( ! hst::isByteSearchable( lineDelim.wstr() + vertDelim.wstr() ) )
+    {
+      throw std::runtime_error(
+        ( L"Could not read columns from \"" + sourceName +
+          L"\". Column and row delimiters must be single-byte characters." )
+          .mb_str() );
+    }
+
+    // The parsed rows of one chunk, and the first error found in it.
+    struct Chunk
+    {
+      std::string_view text;
+      Columns columns;
+      std::size_t rowCount = 0;
+      bool failed = false;
+      std::size_t failedColumn = 0;
+      std::string failedCell;
+      std::string failure;
+    };
+
+    DelimiterSet const rowDelimiters( vertDelim.str() );
+    DelimiterSet const cellDelimiters( lineDelim.str() );
+    std::size_t const chunkSize = 1 << 20;
+    auto const chunkCount = std::max< std::size_t >(
+      1,
+      std::min( source.size() / chunkSize, 4 * TaskPool::shared().size() ) );
+    std::vector< Chunk > chunks( chunkCount );
+    std::size_t chunkStart = 0;
+
+    for ( std::size_t i = 0; i < chunkCount; ++i )
+    {
+      auto chunkEnd = source.size();
+
+      if ( i + 1 < chunkCount )
+      {
+        chunkEnd =
+          std::max( chunkStart, source.size() / chunkCount * ( i + 1 ) );
+        chunkEnd = rowDelimiters.find( source, chunkEnd );
+        chunkEnd = chunkEnd == std::string_view::npos ? source.size()
+                                                      : chunkEnd + 1;
+      }
+      chunks[ i ].text = source.substr( chunkStart, chunkEnd - chunkStart );
+      chunks[ i ].columns = makeColumns();
+      chunkStart = chunkEnd;
+    }
+
+    auto const parseChunk = [ & ]( Chunk & chunk ) {
+      std::vector< std::string_view > cells;
+
+      for ( auto const & row : Tokenizer( chunk.text, rowDelimiters ) )
+      {
+        // Cells are split on every delimiter, so empty cells keep their
+        // column.
+        cells.clear();
+        for ( std::size_t cellStart = 0;; )
+        {
+          auto const cellEnd = cellDelimiters.find( row, cellStart );
+
+          if ( cellEnd == std::string_view::npos )
+          {
+            cells.push_back( row.substr( cellStart ) );
+            break;
+          }
+          cells.push_back( row.substr( cellStart, cellEnd - cellStart ) );
+          cellStart = cellEnd + 1;
+        }
+
+        if ( cells.size() != columnCount )
+        {
+          chunk.failed = true;
+          chunk.failedColumn = std::min( cells.size(), columnCount );
+          chunk.failure = "Expected " + std::to_string( columnCount ) +
+            " cells but found " + std::to_string( cells.size() );
+          return;
+        }
+        if ( ! parseRow( chunk.columns, cells.data(), chunk.failedColumn ) )
+        {
+          chunk.failed = true;
+          chunk.failedCell = std::string( cells[ chunk.failedColumn ] );
+          chunk.failure = "Could not parse \"" + chunk.failedCell + "\" as " +
+            describeFailure( chunk.failedColumn );
+          return;
+        }
+        ++chunk.rowCount;
+      }
+    };
 
-    /*
-      Check if an output stream is currently opened on the source pointed to by
-      pathOrID. If pathOrID is a stored ID, the ID's target will be used to
-      check for the target stream, otherwise pathOrID will be used to check for
-      the target stream.
-      Ex: Path Map contains [ { "data", "/dir/data/file.txt" } ]
-        hasOutputStream( "data" ) -> checks if there is an output stream stored
-          under"/dir/data/file.txt"
-    */
-    bool hasOutputStream( hst::hstring const & pathOrID );
+    if ( chunkCount == 1 ) { parseChunk( chunks[ 0 ] ); }
+    else
+    {
+      TaskGroup group;
 
-    /*
-      Retrieve a previously opened input stream pointed to by pathOrID. If
-      pathOrID is a stored ID, the ID's target will be used to retrieve the
-      target stream, otherwise pathOrID will be used to retrieve the target
-      stream.
-      Ex: Path Map contains [ { "data", "/dir/data/file.txt" } ]
-        getInputStream( "data" ) -> retrieves the input stream stored
-          under"/dir/data/file.txt"
-    */
-    std::wistream & getInputStream( hst::hstring const & pathOrID ) const;
+      for ( auto & it : chunks )
+      {
+        group.run( [ &parseChunk, &it ] { parseChunk( it ); } );
+      }
+      group.wait();
+    }
 
-    /*
-      Retrieve a previously opened output stream pointed to by pathOrID. If
-      pathOrID is a stored ID, the ID's target will be used to retrieve the
-      target stream, otherwise pathOrID will be used to retrieve the target
-      stream.
-      Ex: Path Map contains [ { "data", "/dir/data/file.txt" } ]
-        getOutputStream( "data" ) -> retrieves the output stream stored
-          under"/dir/data/file.txt"
-    */
-    std::wostream & getOutputStream( hst::hstring const & pathOrID ) const;
+    std::size_t row = 0;
 
-    /*
-      Read one unaltered line from a previously opened input stream pointed
-      to by pathOrID. If pathOrID is a stored ID, the ID's target will be used
-      to read from the target stream, otherwise pathOrID will be used to
-      read from the target stream.
-      Ex: Path Map contains [ { "data", "/dir/data/file.txt" } ]
-        readLine( "data" ) -> reads one line from the input stream stored
-          under"/dir/data/file.txt"
-    */
-    hst::hstring readLine( hst::hstring const & pathOrID );
+    for ( auto & it : chunks )
+    {
+      if ( it.failed )
+      {
+        row += it.rowCount;
+        throw ParseError( ( it.failure + " at row " + std::to_string( row ) +
+                            ", column " + std::to_string( it.failedColumn ) +
+                            " of \"" + sourceName.str() + "\"." ),
+                          row,
+                          it.failedColumn,
+                          it.failedCell );
+      }
+      row += it.rowCount;
+    }
 
-    /*
-      Write one unaltered line to a previously opened output stream pointed
-      to by pathOrID. If pathOrID is a stored ID, the ID's target will be used
-      to write to the target stream, otherwise pathOrID will be used to
-      write to the target stream.
-      Ex: Path Map contains [ { "data", "/dir/data/file.txt" } ]
-        writeLine( "data", "foo\n" ) -> writes "foo\n" to the output stream
-          stored under"/dir/data/file.txt"
-    */
-    FIO & writeLine( hst::hstring const & pathOrID,
-                     hst::hstring const & source );
+    auto columns = std::move( chunks[ 0 ].columns );
 
-    /*
-      Finds all regular files matching a given file extension starting at a
-      directory pointed to by pathOrID. If pathOrID is a stored ID, the ID's
-      target will be used to find the files, otherwise pathOrID
-      will be used to write to find the files. Optionally recursively
-      searches through sub-directories.
-      Ex: findFiles( ".txt", "/dir", RecursiveSearchTrue ) -> a vector of .txt
-        filenames in or below /dir.
-      Ex: findFiles( ".png", "/dir", RecursiveSearchFalse ) -> a vector of .png
-        filenames only within /dir.
-    */
-    std::vector< hst::hstring > findFiles(
-      hst::hstring const & fileExtension = L".*",
-      hst::hstring const & pathOrID = L"__root",
-      bool const & recursiveSearch = RecursiveSearchTrue ) const;
+    for ( std::size_t i = 1; i < chunkCount; ++i )
+    {
+      appendColumns( columns, std::move( chunks[ i ].columns ) );
+    }
+    return columns;
+  }
 
-    /*
-      Read the unaltered contents of a file pointed
-      to by pathOrID. If pathOrID is a stored ID, the ID's target will be used
-      as the target filepath, otherwise pathOrID will be used as the target
-      filepath. There does not need to be an open stream on the filepath. Will
-      reset an open filestream to its filestart before reading.
-      Ex: Path Map contains [ { "data", "/dir/data/file.txt" } ]
-        readFile( "data" ) -> reads the contents of "/dir/data/file.txt"
-    */
-    hst::hstring readFile( hst::hstring const & pathOrID );
+  // Moves the values of one column onto the back of another.
+  template < typename ValueType >
+  inline void appendColumn( std::vector< ValueType > & column,
+                            std::vector< ValueType > && values )
+  {
+    if ( column.empty() ) { column = std::move( values ); }
+    else
+    {
+      column.insert( column.end(),
+                     std::make_move_iterator( values.begin() ),
+                     std::make_move_iterator( values.end() ) );
+    }
+  }
 
-    /*
-      Read the contents of a file pointed to by pathOrID as a vector split on
-      all provided delimiting characters. If pathOrID is a stored ID, the ID's
-      target will be used as the target filepath, otherwise pathOrID will be
-      used as the target filepath. There does not need to be an open stream on
-      the filepath. Will reset an open filestream to its filestart before
-      reading.
-      Ex: Path Map contains [ { "data", "/dir/data/file.txt" } ]
-        readFileToVector( "data", "\n\r" ) -> reads the contents of
-        "/dir/data/file.txt", split on the '\n' and '\r' characters.
-    */
-    std::vector< hst::hstring > readFileToVector(
-      hst::hstring const & pathOrID, hst::hstring const & delim = L"\n\r" );
+  // Parses one row of cells into a tuple of columns.
+  template < typename Columns, std::size_t... I >
+  inline bool parseRow( Columns & columns,
+                        std::string_view const * cells,
+                        std::size_t & failedColumn,
+                        std::index_sequence< I... > )
+  {
+    return ( ( parseCell( cells[ I ], std::get< I >( columns ) ) ||
+               ( failedColumn = I, false ) ) &&
+             ... );
+  }
 
-    /*
-      Read the contents of a file pointed to by pathOrID as a vector of
-      vectors, split on all provided delimiting characters. If pathOrID is a
-      stored ID, the ID's target will be used as the target filepath, otherwise
-      pathOrID will be used as the target filepath. There does not need to be
-      an open stream on the filepath. Will reset an open filestream to its
-      filestart before reading.
-      Ex: Path Map contains [ { "data", "/dir/data/file.txt" } ]
-        readFileToMatrix( "data", ",", "\n\r" ) -> reads the contents of
-          "/dir/data/file.txt", split horizontally on the ',' character, and
-          split vertically on the '\n' and '\r' characters.
-    */
-    std::vector< std::vector< hst::hstring > > readFileToMatrix(
-      hst::hstring const & pathOrID,
-      hst::hstring const & lineDelim = L",",
-      hst::hstring const & vertDelim = L"\n\r" );
+  // Moves the values of a tuple of columns onto the back of another.
+  template < typename Columns, std::size_t... I >
+  inline void appendColumns( Columns & columns,
+                             Columns && values,
+                             std::index_sequence< I... > )
+  {
+    ( appendColumn( std::get< I >( columns ),
+                    std::move( std::get< I >( values ) ) ),
+      ... );
+  }
 
-    // Finds the application's root directory (Where the executable is located).
-    hst::hstring findRootDir() const;
+  template < typename... ColumnTypes >
+  inline std::tuple< std::vector< ColumnTypes >... > FIO::readFileToColumns(
+    hst::hstring const & pathOrID,
+    hst::hstring const & lineDelim /* = L"," */,
+    hst::hstring const & vertDelim /* = L"\n\r" */ )
+  {
+    using Columns = std::tuple< std::vector< ColumnTypes >... >;
+    using Indices = std::index_sequence_for< ColumnTypes... >;
 
-    /*
-      Sets the root directory of FIO to the filepath pointed to by pathOrID. If
-      pathOrID is a stored ID, the ID's target will be used as the root
-      filepath, otherwise pathOrID will be used as the root filepath.
-      Ex: Path Map contains [ { "data", "/dir/data/file.txt" } ]
-        setRootDir( "data") -> sets the root dir to "/dir/data/file.txt"
-        setRootDir( "/dir/data/pictures" ) -> sets the root dir to
-          "/dir/data/pictures"
-    */
-    FIO & setRootDir( hst::hstring const & pathOrID );
+    auto const path = getPath( pathOrID );
+    IOStatsRecorder::Scope scope(
+      statsRecorder, path, IOOperation::ReadFile );
+
+    rewindOpenInputStream( path );
+
+    auto const file = mapFile( path );
+
+    scope.addBytesRead( file.size() );
+    return parseColumns< Columns >(
+      file.view(),
+      path,
+      sizeof...( ColumnTypes ),
+      lineDelim,
+      vertDelim,
+      [] { return Columns(); },
+      []( Columns & columns,
+          std::string_view const * cells,
+          std::size_t & failedColumn ) {
+        return parseRow( columns, cells, failedColumn, Indices() );
+      },
+      []( Columns & columns, Columns && values ) {
+        appendColumns( columns, std::move( values ), Indices() );
+      },
+      []( std::size_t const & column ) {
+        char const * const names[] = { columnTypeName< ColumnTypes >()... };
+        return std::string( names[ column ] );
+      } );
+  }
 
-    // Returns the root directory's currently stored filepath.
-    hst::hstring getRootDir() const;
+  inline std::vector< Column > FIO::readFileToColumns(
+    hst::hstring const & pathOrID,
+    std::vector< ColumnType > const & schema,
+    hst::hstring const & lineDelim /* = L"," */,
+    hst::hstring const & vertDelim /* = L"\n\r" */ )
+  {
+    using Columns = std::vector< Column >;
 
-    /*
-      Stores the path provided in the Path Map at the ID provided. The path
-      can then be accessed using the ID for convenience. The ID "__root" is
-      reserved by FIO, and may only be changed using the FIO::setRootDir()
-      member function.
-    */
-    FIO & storePathAtID( hst::hstring const & ID, hst::hstring const & path );
+    auto const path = getPath( pathOrID );
+    IOStatsRecorder::Scope scope(
+      statsRecorder, path, IOOperation::ReadFile );
 
-    /*
-      Returns the absolute filesystem path associated with the ID stored in the
-      FIO path map. If the ID provided is not contained in the path map, it
-      will be returned unaltered.
-      Ex: Path map contains [ { "data", "/dir/data" },
-          { "users", "/dir/users" } ]
-        getPath( "data" ) -> "/dir/data"
-        getPath( "users" ) -> "/dir/users"
-        getPath( "/dir/images" ) -> "/dir/images"
-        getPath( "invalid" ) -> "invalid"
-    */
-    hst::hstring getPath( hst::hstring const & pathOrID ) const;
+    rewindOpenInputStream( path );
 
-    // Removes the path located in the FIO path map at the ID provided.
-    FIO & removePathAtID( hst::hstring const & ID );
+    auto const file = mapFile( path );
 
-    private:
-    // Checks that the ID points to a valid input stream.
-    std::wistream & validateInputStream( hst::hstring const & ID ) const;
-    // Checks that the ID points to a valid output stream.
-    std::wostream & validateOutputStream( hst::hstring const & ID ) const;
+    scope.addBytesRead( file.size() );
+    return parseColumns< Columns >(
+      file.view(),
+      path,
+      schema.size(),
+      lineDelim,
+      vertDelim,
+      [ &schema ] {
+        Columns columns;
 
-    // The Path Map in which path shorthands to files and directories are
-    // stored.
-    std::unordered_map< std::wstring, std::wstring > pathIDM;
-    // The input file stream map in which open input streams are stored.
-    std::unordered_map< std::wstring, std::unique_ptr< std::wifstream > >
-      inputFSM;
-    // The output file stream map in which open output streams are stored.
-    std::unordered_map< std::wstring, std::unique_ptr< std::wofstream > >
-      outputFSM;
-  };
+        for ( auto const & it : schema )
+        {
+          switch ( it )
+          {
+            case ColumnType::Integer:
+              columns.emplace_back( std::vector< std::int64_t >() );
+              break;
+            case ColumnType::Real:
+              columns.emplace_back( std::vector< double >() );
+              break;
+            case ColumnType::Text:
+              columns.emplace_back( std::vector< std::string >() );
+              break;
+          }
+        }
+        return columns;
+      },
+      []( Columns & columns,
+          std::string_view const * cells,
+          std::size_t & failedColumn ) {
+        for ( std::size_t i = 0; i < columns.size(); ++i )
+        {
+          auto const parseInto = [ & ]( auto & column ) {
+            return parseCell( cells[ i ], column );
+          };
 
-  inline hst::hstring parentDir( hst::hstring const & path )
-  {
-    auto str = path.wstr();
-    auto const delim = str.find_last_of( L"/\\" );
+          if ( ! std::visit( parseInto, columns[ i ] ) )
+          {
+            failedColumn = i;
+            return false;
+          }
+        }
+        return true;
+      },
+      []( Columns & columns, Columns && values ) {
+        for ( std::size_t i = 0; i < columns.size(); ++i )
+        {
+          std::visit(
+            [ & ]( auto & column ) {
+              using ColumnVector = std::decay_t< decltype( column ) >;
+              appendColumn(
+                column, std::move( std::get< ColumnVector >( values[ i ] ) ) );
+            },
+            columns[ i ] );
+        }
+      },
+      [ &schema ]( std::size_t const & column ) {
+        switch ( schema[ column ] )
+        {
+          case ColumnType::Integer: return std::string( "an integer" );
+          case ColumnType::Real: return std::string( "a number" );
+          default: return std::string( "text" );
+        }
+      } );
+  }
 
-    if ( delim != std::wstring::npos ) { str = str.substr( 0, delim ); }
-    return str;
+  inline FIO & FIO::copyFile( hst::hstring const & sourcePathOrID,
+                              hst::hstring const & destinationPathOrID )
+  {
+    copyResolvedFile( getPath( sourcePathOrID ),
+                      getPath( destinationPathOrID ) );
+    return *this;
   }
 
-  inline hst::hstring baseFile(
-    hst::hstring const & pathToFile,
-    bool const & stripExtension /* = StripExtensionTrue */ )
+  inline FIO & FIO::moveFile( hst::hstring const & sourcePathOrID,
+                              hst::hstring const & destinationPathOrID )
   {
-    auto const directoryPath = parentDir( pathToFile ).wstr();
-    auto filePath = pathToFile.wstr();
+    auto const source = getPath( sourcePathOrID );
+    auto const destination = getPath( destinationPathOrID );
 
-    if ( directoryPath.size() < filePath.size() )
+    // Streams keep the handle they opened, which would no longer match
+    // their path.
+    for ( auto const & path : { source, destination } )
     {
-      filePath = filePath.substr( directoryPath.size() + 1 );
+      auto const handle = paths.find( path );
+
+      if ( hasInputStream( handle ) || hasOutputStream( handle ) )
+      {
+        throw std::runtime_error(
+          ( L"File \"" + source + L"\" could not be moved to \"" +
+            destination + L"\" while a stream is open on \"" + path + L"\"" )
+            .mb_str() );
+      }
     }
-    if ( stripExtension == StripExtensionTrue )
+
+#ifdef WINDOWS
+    if ( ::MoveFileExW( source.wc_str(),
+                        destination.wc_str(),
+                        MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH ) )
     {
-      auto const delim = filePath.find_last_of( L"." );
+      return *this;
+    }
 
-      if ( delim != std::wstring::npos )
+    auto error = ::GetLastError();
+
+    if ( error == ERROR_NOT_SAME_DEVICE )
+    {
+      copyResolvedFile( source, destination );
+      if ( ::DeleteFileW( source.wc_str() ) ) { return *this; }
+      error = ::GetLastError();
+    }
+    throw std::system_error(
+      static_cast< int >( error ),
+      std::system_category(),
+      ( L"File \"" + source + L"\" could not be moved to \"" + destination +
+        L"\". System Error Message" )
+        .mb_str() );
+#else
+    if ( ::rename( source.mb_str(), destination.mb_str() ) == 0 )
+    {
+      syncDirectory( destination.str() );
+      return *this;
+    }
+
+    auto error = errno;
+
+    if ( error == EXDEV )
+    {
+      copyResolvedFile( source, destination );
+      if ( ::unlink( source.mb_str() ) == 0 )
       {
-        filePath = filePath.substr( 0, delim );
+        syncDirectory( source.str() );
+        return *this;
       }
+      error = errno;
     }
-    return filePath;
+    throw std::system_error(
+      error,
+      std::system_category(),
+      ( L"File \"" + source + L"\" could not be moved to \"" + destination +
+        L"\". System Error Message" )
+        .mb_str() );
+#endif
   }
 
-  inline std::vector< hst::hstring > splitString(
-    hst::hstring const & source, hst::hstring const & delim /* = L"\n\r" */ )
+  inline FIO & FIO::atomicWriteFile( hst::hstring const & pathOrID,
+                                     std::string_view const & contents )
   {
-    auto str = source.wstr();
-    auto const del = delim.wstr();
-    std::vector< hst::hstring > splitStr;
-    std::size_t i;
+    auto const path = getPath( pathOrID );
+
+#ifdef WINDOWS
+    auto const tempPath = tempPathFor( path );
+    HANDLE const fileHandle = ::CreateFileW( tempPath.wc_str(),
+                                             GENERIC_WRITE,
+                                             0,
+                                             NULL,
+                                             CREATE_NEW,
+                                             FILE_ATTRIBUTE_NORMAL,
+                                             NULL );
+    DWORD error = 0;
+
+    if ( fileHandle == INVALID_HANDLE_VALUE ) { error = ::GetLastError(); }
+    else
+    {
+      // Reserving the space up front keeps the file contiguous.
+      FILE_ALLOCATION_INFO allocation;
+      allocation.AllocationSize.QuadPart =
+        static_cast< LONGLONG >( contents.size() );
+      ::SetFileInformationByHandle(
+        fileHandle, FileAllocationInfo, &allocation, sizeof( allocation ) );
+
+      for ( std::size_t written = 0; ! error && written < contents.size(); )
+      {
+        DWORD wrote = 0;
+        auto const length = static_cast< DWORD >(
+          std::min< std::size_t >( contents.size() - written, 1 << 30 ) );
+
+        if ( ! ::WriteFile(
+               fileHandle, contents.data() + written, length, &wrote, NULL ) )
+        {
+          error = ::GetLastError();
+        }
+        written += wrote;
+      }
+      if ( ! error && ! ::FlushFileBuffers( fileHandle ) )
+      {
+        error = ::GetLastError();
+      }
+      ::CloseHandle( fileHandle );
+      if ( ! error &&
+           ! ::MoveFileExW( tempPath.wc_str(),
+                            path.wc_str(),
+                            MOVEFILE_REPLACE_EXISTING |
+                              MOVEFILE_WRITE_THROUGH ) )
+      {
+        error = ::GetLastError();
+      }
+      if ( error ) { ::DeleteFileW( tempPath.wc_str() ); }
+    }
+    if ( error )
+    {
+      throw std::system_error(
+        static_cast< int >( error ),
+        std::system_category(),
+        ( L"File \"" + path + L"\" could not be written. System Error Message" )
+          .mb_str() );
+    }
+#else
+    std::string tempPath;
+    int descriptor = -1;
+    auto error = createTempFile( path, 0666, tempPath, descriptor );
 
-    while ( ( i = str.find_first_of( del ) ) != std::wstring::npos )
+    if ( ! error )
     {
-      auto const substr = str.substr( 0, i );
+      struct stat info;
+
+      if ( ::stat( path.mb_str(), &info ) == 0 )
+      {
+        ::fchmod( descriptor, info.st_mode & 07777 );
+      }
+  #ifdef __linux__
+      // Reserving the space up front keeps the file contiguous, and reports
+      // a full disk before anything is written.
+      if ( ! contents.empty() &&
+           ::fallocate( descriptor, 0, 0, contents.size() ) < 0 &&
+           errno == ENOSPC )
+      {
+        error = ENOSPC;
+      }
+  #endif
+      for ( std::size_t written = 0; ! error && written < contents.size(); )
+      {
+        auto const wrote = ::write( descriptor,
+                                    contents.data() + written,
+                                    contents.size() - written );
 
-      if ( substr.find_first_not_of( del ) != std::wstring::npos )
+        if ( wrote >= 0 ) { written += wrote; }
+        else if ( errno != EINTR ) { error = errno; }
+      }
+      if ( error )
       {
-        splitStr.push_back( substr );
+        ::close( descriptor );
+        ::unlink( tempPath.c_str() );
       }
-      str.erase( 0, i + 1 );
+      else { error = commitTempFile( descriptor, tempPath, path.str() ); }
     }
-    if ( str.find_first_not_of( del ) != std::wstring::npos )
+    if ( error )
     {
-      splitStr.push_back( str );
+      throw std::system_error(
+        error,
+        std::system_category(),
+        ( L"File \"" + path + L"\" could not be written. System Error Message" )
+          .mb_str() );
     }
-
-    return splitStr;
+#endif
+    return *this;
   }
 
-  inline void deleteFile( hst::hstring const & pathToFile )
+  inline void FIO::copyResolvedFile( hst::hstring const & source,
+                                     hst::hstring const & destination )
   {
-    try
+#ifdef WINDOWS
+    auto const tempPath = tempPathFor( destination );
+    DWORD error = 0;
+
+    // CopyFileExW picks the fastest copy the volume supports, including
+    // block cloning.
+    if ( ! ::CopyFileExW( source.wc_str(),
+                          tempPath.wc_str(),
+                          NULL,
+                          NULL,
+                          NULL,
+                          COPY_FILE_FAIL_IF_EXISTS ) )
     {
-      std::remove( pathToFile.mb_str() );
+      error = ::GetLastError();
     }
-    catch ( std::exception & e )
+    else
     {
-      throw std::runtime_error( ( "Could not remove file: \"" + pathToFile +
-                                  "\"." + "Error Message: \"" + e.what() +
-                                  "\"" )
-                                  .mb_str() );
+      // The copy is flushed to disk before it replaces the destination.
+      HANDLE const copy = ::CreateFileW( tempPath.wc_str(),
+                                         GENERIC_WRITE,
+                                         0,
+                                         NULL,
+                                         OPEN_EXISTING,
+                                         FILE_ATTRIBUTE_NORMAL,
+                                         NULL );
+
+      if ( copy == INVALID_HANDLE_VALUE ) { error = ::GetLastError(); }
+      else
+      {
+        if ( ! ::FlushFileBuffers( copy ) ) { error = ::GetLastError(); }
+        ::CloseHandle( copy );
+      }
+      if ( ! error && ! ::MoveFileExW( tempPath.wc_str(),
+                                       destination.wc_str(),
+                                       MOVEFILE_REPLACE_EXISTING |
+                                         MOVEFILE_WRITE_THROUGH ) )
+      {
+        error = ::GetLastError();
+      }
+      if ( error ) { ::DeleteFileW( tempPath.wc_str() ); }
     }
-  }
-
-  inline FIO::FIO( hst::hstring const & loc /* = "" */ )
-  {
-    if ( ! setlocale( LC_ALL, loc.mb_str() ) )
+    if ( error )
     {
-      throw std::runtime_error(
-        ( "Could not set locale to: \"" + loc + "\"!" ).mb_str() );
+      throw std::system_error(
+        static_cast< int >( error ),
+        std::system_category(),
+        ( L"File \"" + source + L"\" could not be copied to \"" + destination +
+          L"\". System Error Message" )
+          .mb_str() );
     }
-    setRootDir( findRootDir() );
-  }
-
-  inline FIO & FIO::clear()
-  {
-    auto const currentRootDir = getRootDir();
-
-    pathIDM.clear();
-    inputFSM.clear();
-    outputFSM.clear();
-
-    setRootDir( currentRootDir );
-
-    return *this;
-  }
-
-  inline std::wistream & FIO::openInputStream( hst::hstring const & pathOrID )
-  {
-    auto const path = getPath( pathOrID );
+#else
+    int const sourceDescriptor =
+      ::open( source.mb_str(), O_RDONLY | O_CLOEXEC );
+    struct stat info;
+    int error = 0;
 
-    if ( inputFSM.find( path ) == inputFSM.end() )
+    if ( sourceDescriptor < 0 || ::fstat( sourceDescriptor, &info ) < 0 )
     {
-      inputFSM[ path ] =
-        std::make_unique< std::wifstream >( path.str(), std::wifstream::in );
+      error = errno;
     }
-    return validateInputStream( path );
-  }
-
-  inline std::wostream & FIO::openOutputStream(
-    hst::hstring const & pathOrID,
-    bool const & appendToFile /* = OpenNewFile */ )
-  {
-    auto const path = getPath( pathOrID );
+    else
+    {
+      std::string tempPath;
+      int descriptor = -1;
 
-    if ( outputFSM.find( path ) == outputFSM.end() )
+      error = createTempFile(
+        destination, info.st_mode & 07777, tempPath, descriptor );
+      if ( ! error )
+      {
+        // Fewer blocks than bytes means the source has holes.
+        bool const sparse =
+          static_cast< std::uint64_t >( info.st_blocks ) * 512 <
+          static_cast< std::uint64_t >( info.st_size );
+
+        error = copyFileContents(
+          sourceDescriptor, descriptor, info.st_size, sparse );
+        if ( error )
+        {
+          ::close( descriptor );
+          ::unlink( tempPath.c_str() );
+        }
+        else
+        {
+          error = commitTempFile( descriptor, tempPath, destination.str() );
+        }
+      }
+    }
+    if ( sourceDescriptor >= 0 ) { ::close( sourceDescriptor ); }
+    if ( error )
     {
-      outputFSM[ path ] = std::make_unique< std::wofstream >(
-        path.str(),
-        ( appendToFile ? std::wofstream::app : std::wofstream::out ) );
+      throw std::system_error(
+        error,
+        std::system_category(),
+        ( L"File \"" + source + L"\" could not be copied to \"" + destination +
+          L"\". System Error Message" )
+          .mb_str() );
     }
-    return validateOutputStream( path );
-  }
-
-  inline std::wistream & FIO::rewindInputStream( hst::hstring const & pathOrID )
-  {
-    auto & stream = validateInputStream( getPath( pathOrID ) );
-    stream.clear();
-    return stream.seekg( 0, std::ios::beg );
-  }
-
-  inline FIO & FIO::closeInputStream( hst::hstring const & pathOrID )
-  {
-    auto const it = inputFSM.find( getPath( pathOrID ) );
-
-    if ( it != inputFSM.end() ) { inputFSM.erase( it ); }
-    return *this;
-  }
-
-  inline FIO & FIO::closeOutputStream( hst::hstring const & pathOrID )
-  {
-    auto const it = outputFSM.find( getPath( pathOrID ) );
-
-    if ( it != outputFSM.end() ) { outputFSM.erase( it ); }
-    return *this;
-  }
-
-  inline bool FIO::hasInputStream( hst::hstring const & pathOrID )
-  {
-    return inputFSM.find( getPath( pathOrID ) ) != inputFSM.end();
+#endif
   }
 
-  inline bool FIO::hasOutputStream( hst::hstring const & pathOrID )
+  inline hst::hstring FIO::tempPathFor( hst::hstring const & path )
   {
-    return outputFSM.find( getPath( pathOrID ) ) != outputFSM.end();
-  }
+    static std::atomic< std::uint64_t > tempFiles{ 0 };
 
-  inline std::wistream & FIO::getInputStream(
-    hst::hstring const & pathOrID ) const
-  {
-    return validateInputStream( getPath( pathOrID ) );
-  }
+    auto const & str = path.wstr();
+    auto const delim = str.find_last_of( L"/\\" );
+    auto const nameStart = delim == std::wstring::npos ? 0 : delim + 1;
 
-  inline std::wostream & FIO::getOutputStream(
-    hst::hstring const & pathOrID ) const
-  {
-    return validateOutputStream( getPath( pathOrID ) );
+#ifdef WINDOWS
+    auto const processID = ::GetCurrentProcessId();
+#else
+    auto const processID = ::getpid();
+#endif
+    return str.substr( 0, nameStart ) + L"." + str.substr( nameStart ) +
+      L".fio" + std::to_wstring( processID ) + L"." +
+      std::to_wstring( ++tempFiles );
   }
 
-  inline hst::hstring FIO::readLine( hst::hstring const & pathOrID )
+#ifndef WINDOWS
+  inline int FIO::createTempFile( hst::hstring const & path,
+                                  mode_t const & mode,
+                                  std::string & tempPath,
+                                  int & descriptor )
   {
-    std::wstring line;
-    std::getline( validateInputStream( getPath( pathOrID ) ), line );
-    return line;
-  }
+    // Names left behind by a crashed process with the same ID are skipped.
+    for ( int attempt = 0; attempt < 100; ++attempt )
+    {
+      tempPath = tempPathFor( path ).str();
+      descriptor = ::open( tempPath.c_str(),
+                           O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC,
+                           mode );
 
-  inline FIO & FIO::writeLine( hst::hstring const & pathOrID,
-                               hst::hstring const & source )
-  {
-    validateOutputStream( getPath( pathOrID ) ) << source;
-    return *this;
+      if ( descriptor >= 0 ) { return 0; }
+      if ( errno != EEXIST ) { return errno; }
+    }
+    return EEXIST;
   }
 
-#ifdef WINDOWS
-  #ifndef PATH_SEP
-    // Windows-style path separator
-    #define PATH_SEP hst::hstring( L"\\" )
-  #endif
-#else
-  #ifndef PATH_SEP
-    // Unix-style path separator
-    #define PATH_SEP hst::hstring( L"/" )
-  #endif
-#endif
-
-  inline std::vector< hst::hstring > FIO::findFiles(
-    hst::hstring const & fileExtension /* = L".*" */,
-    hst::hstring const & pathOrID /* = L"__root" */,
-    bool const & recursiveSearch /* = RecursiveSearchTrue */ ) const
+  inline int FIO::copyFileContents( int const & source,
+                                    int const & destination,
+                                    std::uint64_t const & size,
+                                    bool const & sparse )
   {
-    std::vector< hst::hstring > foundFiles;
-    auto const rootDir = getPath( pathOrID );
-
-#ifdef WINDOWS
-    auto const searchPath = rootDir + PATH_SEP + hst::hstring( "*.*" );
+    std::uint64_t copied = 0;
+
+  #ifdef __linux__
+    #ifndef FICLONE
+      #define FICLONE _IOW( 0x94, 9, int )
+    #endif
+    // Each copy method continues where the one before it stopped, giving up
+    // on the errors meaning the files do not support it.
+    auto const unsupported = []( int const error ) {
+      return error == EXDEV || error == ENOSYS || error == EINVAL ||
+        error == EOPNOTSUPP || error == ENOTTY || error == EBADF;
+    };
+
+    // Filesystems with reflinks share the source's blocks instead.
+    if ( size > 0 && ::ioctl( destination, FICLONE, source ) == 0 )
+    {
+      return 0;
+    }
+    if ( size > 0 && ! sparse &&
+         ::fallocate( destination, 0, 0, size ) < 0 && errno == ENOSPC )
+    {
+      return ENOSPC;
+    }
 
-    WIN32_FIND_DATAW info;
-    HANDLE dirHandle = ::FindFirstFileW( searchPath.wc_str(), &info );
+    bool kernelCopy = size > 0;
 
-    if ( dirHandle != INVALID_HANDLE_VALUE )
+    while ( kernelCopy && copied < size )
+    {
+      loff_t sourceOffset = copied;
+      loff_t destinationOffset = copied;
+      auto const result = ::copy_file_range( source,
+                                             &sourceOffset,
+                                             destination,
+                                             &destinationOffset,
+                                             size - copied,
+                                             0 );
+
+      if ( result > 0 ) { copied += result; }
+      else if ( result == 0 ) { kernelCopy = false; }
+      else if ( unsupported( errno ) ) { break; }
+      else if ( errno != EINTR ) { return errno; }
+    }
+    if ( kernelCopy && copied < size &&
+         ::lseek( destination, copied, SEEK_SET ) >= 0 )
     {
-      while ( ::FindNextFileW( dirHandle, &info ) )
+      while ( copied < size )
       {
-        auto const fileName = hst::hstring( info.cFileName );
-
-        if ( fileName == L"." || fileName == L".." ) { continue; }
-
-        auto const filePath = rootDir + PATH_SEP + fileName;
-
-        if ( ! ( info.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY ) )
-        {
-          if ( fileExtension == L".*" ||
-               ( fileName.wstr().length() > fileExtension.wstr().length() &&
-                 fileName.wstr().substr( fileName.wstr().length() -
-                                         fileExtension.wstr().length() ) ==
-                   fileExtension ) )
-          {
-            foundFiles.push_back( filePath );
-          }
-        }
-        else if ( ( recursiveSearch == RecursiveSearchTrue ) &&
-                  ( info.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY ) )
-        {
-          auto const subDirFiles = findFiles( fileExtension, filePath );
-
-          for ( auto const & it : subDirFiles ) { foundFiles.push_back( it ); }
-        }
+        off_t sourceOffset = copied;
+        auto const result = ::sendfile( destination,
+                                        source,
+                                        &sourceOffset,
+                                        std::min< std::uint64_t >(
+                                          size - copied, 0x7ffff000 ) );
+
+        if ( result > 0 ) { copied += result; }
+        else if ( result == 0 || unsupported( errno ) ) { break; }
+        else if ( errno != EINTR ) { return errno; }
       }
-      ::FindClose( dirHandle );
     }
-#else
-    struct dirent * dirInfo;
+  #endif
 
-    DIR * dirhandle = static_cast< DIR * >( opendir( rootDir.mb_str() ) );
+    // Copy whatever is left in large blocks, up to the end of the source,
+    // which also covers files whose size is not known up front.
+    std::size_t const BlockSize = 1 << 20;
+    std::unique_ptr< char[] > const block( new char[ BlockSize ] );
 
-    if ( dirhandle )
+  #ifdef POSIX_FADV_SEQUENTIAL
+    ::posix_fadvise( source, copied, 0, POSIX_FADV_SEQUENTIAL );
+  #endif
+    while ( true )
     {
-      while ( ( dirInfo = readdir( dirhandle ) ) != NULL )
-      {
-        auto const fileName = hst::hstring( dirInfo->d_name );
-
-        if ( fileName == "." || fileName == ".." ) { continue; }
-
-        auto const filePath = rootDir + PATH_SEP + fileName;
-
-        struct stat info;
-        errno = 0;
+      auto const read = ::pread( source, block.get(), BlockSize, copied );
 
-        if ( stat( filePath.mb_str(), &info ) < 0 )
-        {
-          perror( "Invalid File encountered." );
-        }
-        else if ( S_ISREG( info.st_mode ) )
-        {
-          if ( fileExtension == ".*" ||
-               ( fileName.str().length() > fileExtension.str().length() &&
-                 fileName.str().substr( fileName.str().length() -
-                                        fileExtension.str().length() ) ==
-                   fileExtension ) )
-          {
-            foundFiles.push_back( filePath );
-          }
-        }
-        else if ( ( recursiveSearch == RecursiveSearchTrue ) &&
-                  S_ISDIR( info.st_mode ) )
-        {
-          auto const subDirFiles = findFiles( fileExtension, filePath );
+      if ( read == 0 ) { break; }
+      if ( read < 0 )
+      {
+        if ( errno == EINTR ) { continue; }
+        return errno;
+      }
+      for ( ssize_t written = 0; written < read; )
+      {
+        auto const wrote = ::pwrite( destination,
+                                     block.get() + written,
+                                     read - written,
+                                     copied + written );
 
-          for ( auto const & it : subDirFiles ) { foundFiles.push_back( it ); }
-        }
+        if ( wrote >= 0 ) { written += wrote; }
+        else if ( errno != EINTR ) { return errno; }
       }
-      closedir( dirhandle );
+      copied += read;
     }
-#endif
 
-    return foundFiles;
+    // Drop any space reserved beyond a source which shrank while copying.
+    if ( ::ftruncate( destination, copied ) < 0 ) { return errno; }
+    return 0;
   }
 
-  inline hst::hstring FIO::readFile( hst::hstring const & pathOrID )
+  inline int FIO::commitTempFile( int const & descriptor,
+                                  std::string const & tempPath,
+                                  std::string const & path )
   {
-    auto const path = getPath( pathOrID );
-    std::wstringstream wss;
+    int error = 0;
 
-    if ( hasInputStream( path ) ) { wss << rewindInputStream( path ).rdbuf(); }
-    else
+    if ( ::fsync( descriptor ) < 0 ) { error = errno; }
+    if ( ::close( descriptor ) < 0 && ! error ) { error = errno; }
+    if ( ! error && ::rename( tempPath.c_str(), path.c_str() ) < 0 )
     {
-      wss << openInputStream( path ).rdbuf();
-      closeInputStream( path );
+      error = errno;
     }
-    return wss.str();
-  }
-
-  inline std::vector< hst::hstring > FIO::readFileToVector(
-    hst::hstring const & pathOrID, hst::hstring const & delim /* = L"\n\r" */ )
-  {
-    return splitString( readFile( pathOrID ), delim );
+    if ( error )
+    {
+      ::unlink( tempPath.c_str() );
+      return error;
+    }
+    syncDirectory( path );
+    return 0;
   }
 
-  inline std::vector< std::vector< hst::hstring > > FIO::readFileToMatrix(
-    hst::hstring const & pathOrID,
-    hst::hstring const & lineDelim /* = L"," */,
-    hst::hstring const & vertDelim /* = L"\n\r" */ )
+  inline void FIO::syncDirectory( std::string const & path )
   {
-    auto const lines = readFileToVector( pathOrID, vertDelim );
-    std::vector< std::vector< hst::hstring > > matrix;
-
-    for ( auto const & it : lines )
+    auto const delim = path.find_last_of( '/' );
+    auto const directory = delim == std::string::npos ? std::string( "." )
+      : delim == 0                                    ? std::string( "/" )
+                                                      : path.substr( 0, delim );
+    int const descriptor =
+      ::open( directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC );
+
+    // Some filesystems cannot flush directories, which is not an error.
+    if ( descriptor >= 0 )
     {
-      auto const splitLine = splitString( it, lineDelim );
-
-      if ( splitLine.size() > 0 ) { matrix.push_back( splitLine ); }
+      ::fsync( descriptor );
+      ::close( descriptor );
     }
-    return matrix;
   }
+#endif
 
   inline hst::hstring FIO::findRootDir() const
   {
@@ -866,90 +7201,208 @@ namespace FileIO
 
   inline FIO & FIO::setRootDir( hst::hstring const & pathOrID )
   {
-    pathIDM[ L"__root" ] = getPath( pathOrID );
+    auto const path = getPath( pathOrID );
+
+    updatePathMap(
+      [ &path ]( PathMap & paths ) { paths[ L"__root" ] = path; } );
     return *this;
   }
 
-  inline hst::hstring FIO::getRootDir() const { return getPath( L"__root" ); }
+  inline hst::hstring FIO::getRootDir() const { return getPath( "__root" ); }
 
   inline FIO & FIO::storePathAtID( hst::hstring const & ID,
                                    hst::hstring const & path )
   {
-    if ( ID != L"__root" ) { pathIDM[ ID ] = path; }
+    if ( ID.wstr() != L"__root" )
+    {
+      updatePathMap(
+        [ &ID, &path ]( PathMap & paths ) { paths[ ID.wstr() ] = path; } );
+    }
     return *this;
   }
 
   inline hst::hstring FIO::getPath( hst::hstring const & pathOrID ) const
   {
-    auto const it = pathIDM.find( pathOrID );
-    if ( it != pathIDM.end() ) { return it->second; }
+    auto const paths = std::atomic_load( &pathIDM );
+    auto const it = paths->find( pathOrID.wstr() );
+
+    if ( it != paths->end() ) { return it->second; }
     return pathOrID;
   }
 
   inline FIO & FIO::removePathAtID( hst::hstring const & ID )
   {
-    auto const it = pathIDM.find( ID );
-    if ( it != pathIDM.end() ) { pathIDM.erase( it ); }
+    updatePathMap( [ &ID ]( PathMap & paths ) { paths.erase( ID.wstr() ); } );
+    return *this;
+  }
+
+  inline FIO & FIO::enableStats( bool const & enable /* = true */ )
+  {
+    statsRecorder.enable( enable );
+    return *this;
+  }
+
+  inline bool FIO::statsEnabled() const { return statsRecorder.enabled(); }
+
+  inline IOStats FIO::stats() const
+  {
+    auto snapshot = statsRecorder.snapshot();
+
+    for ( auto const & it : *std::atomic_load( &pathIDM ) )
+    {
+      auto const found = snapshot.paths.find( it.second.str() );
+
+      if ( found != snapshot.paths.end() )
+      {
+        found->second.IDs.push_back( hst::hstring( it.first ).str() );
+      }
+    }
+    for ( auto & it : snapshot.paths )
+    {
+      std::sort( it.second.IDs.begin(), it.second.IDs.end() );
+    }
+    return snapshot;
+  }
+
+  inline FIO & FIO::resetStats()
+  {
+    statsRecorder.reset();
     return *this;
   }
 
-  inline std::wistream & FIO::validateInputStream(
-    hst::hstring const & ID ) const
+  template < typename Update >
+  inline void FIO::updatePathMap( Update const & update )
+  {
+    std::lock_guard< std::mutex > guard( pathIDMLock );
+    auto paths = std::make_shared< PathMap >( *std::atomic_load( &pathIDM ) );
+
+    update( *paths );
+    std::atomic_store( &pathIDM, std::shared_ptr< PathMap const >( paths ) );
+  }
+
+  inline void FIO::rewindOpenInputStream( hst::hstring const & path )
+  {
+    auto const handle = paths.find( path );
+    auto const entry =
+      handle ? std::atomic_load( &handle.slot->input ) : nullptr;
+
+    if ( entry )
+    {
+      LockedEntry< InputEntry > const locked{
+        entry, std::unique_lock< std::shared_mutex >( entry->lock ) };
+
+      if ( ! entry->closed ) { rewindInputStream( locked ); }
+    }
+  }
+
+  template < typename Entry >
+  inline void FIO::markClosed( std::shared_ptr< Entry > const & entry )
+  {
+    if ( entry )
+    {
+      std::lock_guard< std::shared_mutex > guard( entry->lock );
+
+      entry->closed = true;
+      // Close the file now, rather than when the last holder lets go.
+      if constexpr ( std::is_same< Entry, BufferedEntry >::value )
+      {
+        entry->stream.flush();
+      }
+      else { entry->stream.close(); }
+    }
+  }
+
+  inline FIO::LockedEntry< FIO::InputEntry > FIO::validateInputStream(
+    PathHandle const & handle,
+    hst::hstring const & ID /* = hst::hstring() */ ) const
   {
-    auto const it = inputFSM.find( ID );
+    LockedEntry< InputEntry > entry;
 
-    if ( it == inputFSM.end() )
+    entry.entry = handle ? std::atomic_load( &handle.slot->input ) : nullptr;
+    if ( entry.entry )
+    {
+      entry.guard = std::unique_lock< std::shared_mutex >( entry->lock );
+    }
+    if ( ! entry.entry || entry->closed )
     {
       throw std::runtime_error(
-        ( L"Could not validate input stream \"" + ID +
+        ( L"Could not validate input stream \"" +
+          ( handle ? handle.path() : ID ) +
           L"\". No such input stream exists. " +
           L"Hint: Did you provide the correct ID?" +
           L" Did you mean to check for an output stream?" )
           .mb_str() );
     }
-    if ( it->second->good() && it->second->is_open() )
-    {
-      return static_cast< std::wistream & >( *it->second.get() );
-    }
+    if ( entry->stream.good() && entry->stream.is_open() ) { return entry; }
     else
     {
       throw std::system_error(
         errno,
         std::system_category(),
-        ( L"Input stream \"" + ID +
+        ( L"Input stream \"" + handle.path() +
           L"\" was found, but it could not be read. System Error Message" )
           .mb_str() );
     }
   }
 
-  inline std::wostream & FIO::validateOutputStream(
-    hst::hstring const & ID ) const
+  inline FIO::LockedEntry< FIO::OutputEntry > FIO::validateOutputStream(
+    PathHandle const & handle,
+    hst::hstring const & ID /* = hst::hstring() */ ) const
   {
-    auto const it = outputFSM.find( ID );
+    LockedEntry< OutputEntry > entry;
 
-    if ( it == outputFSM.end() )
+    entry.entry = handle ? std::atomic_load( &handle.slot->output ) : nullptr;
+    if ( entry.entry )
+    {
+      entry.guard = std::unique_lock< std::shared_mutex >( entry->lock );
+    }
+    if ( ! entry.entry && bufferedEntry( handle ) )
+    {
+      throw std::runtime_error(
+        ( L"Could not validate output stream \"" + handle.path() +
+          L"\". The output stream is buffered. " +
+          L"Hint: Did you mean to use getBufferedOutputStream?" )
+          .mb_str() );
+    }
+    if ( ! entry.entry || entry->closed )
     {
       throw std::runtime_error(
-        ( L"Could not validate output stream \"" + ID +
+        ( L"Could not validate output stream \"" +
+          ( handle ? handle.path() : ID ) +
           L"\". No such output stream exists. " +
           L"Hint: Did you provide the correct ID?" +
           L" Did you mean to check for an input stream?" )
           .mb_str() );
     }
-
-    if ( it->second->good() && it->second->is_open() )
-    {
-      return static_cast< std::wostream & >( *it->second.get() );
-    }
+    if ( entry->stream.good() && entry->stream.is_open() ) { return entry; }
     else
     {
       throw std::system_error(
         errno,
         std::system_category(),
-        ( L"Output stream \"" + ID +
+        ( L"Output stream \"" + handle.path() +
           L"\" was found, but it could not be written to. System Error Message" )
           .mb_str() );
     }
   }
+
+  inline std::shared_ptr< FIO::BufferedEntry >
+  FIO::validateBufferedOutputStream(
+    PathHandle const & handle,
+    hst::hstring const & ID /* = hst::hstring() */ ) const
+  {
+    if ( auto const writer = bufferedEntry( handle ) )
+    {
+      std::shared_lock< std::shared_mutex > guard( writer->lock );
+
+      if ( ! writer->closed ) { return writer; }
+    }
+    throw std::runtime_error(
+      ( L"Could not validate buffered output stream \"" +
+        ( handle ? handle.path() : ID ) +
+        L"\". No such buffered output stream exists. " +
+        L"Hint: Did you provide the correct ID?" )
+        .mb_str() );
+  }
 } // namespace FileIO
 #endif
\ No newline at end of file
@@ -9,6 +9,7 @@
 #include <chrono>
 #include <string>
 #include <iostream>
+#include <thread>
 #include <tuple>
 
 #if defined WIN32 || defined _WIN32 || defined __WIN32 && ! defined __CYGWIN__
@@ -140,6 +141,67 @@ namespace FIOTests
       hstring sToW( s.wstr() );
 
       dessert( ( s == sToW.str() ) ) << hstring( "hstring conversion." );
+
+      std::wstring mixed;
+      for ( int i = 0; i < 200; ++i )
+      {
+        mixed += std::wstring( i % 40, L'a' + i % 26 );
+        mixed += i % 3 == 0 ? L"ß" : ( i % 3 == 1 ? L"€" : L"\U0001F600" );
+      }
+
+      dessert( ( utf8ToWide( wideToUtf8( mixed ) ) == mixed ) )
+        << hstring( "UTF-8 transcoder round trip." );
+      dessert( ( wideToUtf8( L"ß€" ) == "\xC3\x9F\xE2\x82\xAC" ) )
+        << hstring( "UTF-8 transcoder encoding." );
+      dessert( ( utf8ToWide( "ok\xC3" ) == L"ok" &&
+                 utf8ToWide( "ok\xC0\xAFno" ) == L"ok" ) )
+        << hstring( "UTF-8 transcoder stops at malformed sequences." );
+      dessert( ( hstring( std::string( "abc" ) ) == hstring( L"abc" ) &&
+                 hstring( std::string( "abc\xFF" ) ) != hstring( L"abc" ) &&
+                 hstring( L"abc" ) != hstring( std::string( "abc\xFF" ) ) ) )
+        << hstring( "Malformed multi-byte strings never match wide ones." );
+
+      hstring lazy( mixed );
+      hstring lazyCopy( lazy );
+      hstring lazyMoved( std::move( lazyCopy ) );
+
+      // Multi-byte strings only hold these characters in UTF-8 locales.
+      bool const utf8 = isUtf8Locale();
+
+      dessert( ( ( ! utf8 || lazyMoved.str() == wideToUtf8( mixed ) ) &&
+                 lazyMoved.wstr() == mixed && lazy == lazyMoved ) )
+        << hstring( "hstring converts lazily after copy and move." );
+
+      lazyMoved += "tail";
+      dessert( ( lazyMoved.wstr() == mixed + L"tail" &&
+                 ( ! utf8 ||
+                   lazyMoved.str() == wideToUtf8( mixed ) + "tail" ) ) )
+        << hstring( "hstring invalidates cached conversions on append." );
+
+      dessert( ( hstring( L"Größe" ) != hstring( "Gr" ) &&
+                 hstring( "Gr" ) != hstring( L"Größe" ) &&
+                 hstring( L"Größe" ) == hstring( std::wstring( L"Größe" ) ) ) )
+        << hstring( "hstring compares characters lost in conversion." );
+
+      hstring appended;
+      appended += L"Größe";
+      appended += "!";
+      dessert( ( appended.wstr() == L"Größe!" ) )
+        << hstring( "hstring appends keep the stored encoding." );
+
+      hstring const shared( mixed );
+      std::vector< std::thread > readers;
+      std::atomic< int > matches{ 0 };
+
+      for ( int i = 0; i < 4; ++i )
+      {
+        readers.emplace_back( [ &shared, &matches ] {
+          if ( shared.str() == wideToMultiByte( shared.wstr() ) ) { ++matches; }
+        } );
+      }
+      for ( auto & reader : readers ) { reader.join(); }
+      dessert( ( matches == 4 ) )
+        << hstring( "const hstring converts safely from several threads." );
     }
 
     void runStringConcatenationTest()
@@ -342,6 +404,14 @@ namespace FIOTests
       fio.removePathAtID( "newPath" );
       dessert( ( fio.getPath( "newPath" ) == "newPath" ) )
         << hstring( "Unstored path is returned unaltered." );
+
+      fio.storePathAtID( L"pathß1", "APath1" );
+      fio.storePathAtID( L"pathß2", "APath2" );
+      dessert( ( fio.getPath( L"pathß1" ) == "APath1" &&
+                 fio.getPath( L"pathß2" ) == "APath2" ) )
+        << hstring( "IDs differing in non-ASCII characters stay apart." );
+      fio.removePathAtID( L"pathß1" );
+      fio.removePathAtID( L"pathß2" );
     }
 
     void runFIOConstructionTests()
@@ -704,6 +774,49 @@ namespace FIOTests
         dessert( ( it != files2.end() ) ) << hst::hstring( "File finding." );
       }
 
+      auto files4 = fio.findFiles( ".png;*.t?t", fio.getPath( "data" ) );
+
+      dessert( ( files4.size() == files.size() + files2.size() ) )
+        << hst::hstring( "Multi-pattern file finding." );
+
+      auto files5 = fio.findFiles( ".txt",
+                                   fio.getPath( "data" ) + PATH_SEP + "data0",
+                                   RecursiveSearchFalse );
+
+      dessert( ( files5.size() == 10 ) )
+        << hst::hstring( "Non-recursive file finding." );
+
+      std::vector< hst::hstring > streamedFiles;
+      auto const streamedCount = fio.findFiles(
+        [ &streamedFiles ]( hst::hstring const & file ) {
+          streamedFiles.push_back( file );
+        },
+        ".txt",
+        "data" );
+
+      dessert( ( streamedCount == files.size() &&
+                 streamedFiles.size() == files.size() ) )
+        << hst::hstring( "Streamed file finding." );
+      for ( auto const & it : files )
+      {
+        dessert(
+          ( std::find( streamedFiles.begin(), streamedFiles.end(), it ) !=
+            streamedFiles.end() ) )
+          << hst::hstring( "Streamed file finding." );
+      }
+
+      std::size_t nestedReads = 0;
+      fio.findFiles(
+        [ this, &nestedReads ]( hst::hstring const & file ) {
+          nestedReads += fio.readFiles( { file } ).front() ? 1 : 0;
+          nestedReads += fio.findFiles( ".txt", parentDir( file ) ).empty();
+        },
+        ".txt",
+        "data" );
+
+      dessert( ( nestedReads == files.size() ) )
+        << hst::hstring( "Streamed file finding calls back on the caller." );
+
       auto files3 = fio.findFiles( ".*", fio.getPath( "data" ) );
 
       dessert( ( files3.size() != 0 ) ) << hst::hstring( "files3 were found." );
@@ -805,6 +918,1215 @@ namespace FIOTests
       }
     }
 
+    void runMappedFileTest()
+    {
+      initFIOTesting();
+      fio.storePathAtID( "intFile",
+                         fio.getPath( "data" ) + PATH_SEP + "integers.txt" );
+
+      auto const mapped = fio.mapFile( "intFile" );
+      auto const contents = fio.readFile( "intFile" );
+
+      dessert( ( ! mapped.empty() ) ) << hstring( "File maps." );
+      dessert( ( contents == mapped.str() ) )
+        << hstring( "readFile matches mapped file contents." );
+
+      auto const lines = fio.readFileToVector( "intFile" );
+      auto const views = splitStringView( mapped.view() );
+
+      dessert( ( lines.size() == views.size() ) )
+        << hstring( "readFileToVector matches split mapped file." );
+      for ( std::size_t i = 0; i < lines.size() && i < views.size(); ++i )
+      {
+        dessert( ( lines[ i ] == std::string( views[ i ] ) ) )
+          << hstring( "readFileToVector matches split mapped file." );
+      }
+
+      fio.openOutputStream( fio.getPath( "data" ) + PATH_SEP + "empty.txt" );
+      fio.closeOutputStream( fio.getPath( "data" ) + PATH_SEP + "empty.txt" );
+      dessert( ( fio.mapFile( fio.getPath( "data" ) + PATH_SEP + "empty.txt" )
+                   .empty() ) )
+        << hstring( "Empty file maps to an empty view." );
+      deleteFile( fio.getPath( "data" ) + PATH_SEP + "empty.txt" );
+
+      bool missingFileThrowsError = false;
+
+      try
+      {
+        fio.mapFile( fio.getPath( "data" ) + PATH_SEP + "missing.txt" );
+      }
+      catch ( std::runtime_error & e )
+      {
+        missingFileThrowsError = true;
+      }
+      dessert( ( missingFileThrowsError ) )
+        << hstring( "Mapping a missing file throws error." );
+
+      bool unreadableFileThrowsError = false;
+
+      try
+      {
+        fio.mapFile( "data" );
+      }
+      catch ( std::system_error & e )
+      {
+        unreadableFileThrowsError = true;
+      }
+      dessert( ( unreadableFileThrowsError ) )
+        << hstring( "Failing to read an unmappable file throws error." );
+    }
+
+    void runTokenizerTest()
+    {
+      std::string source;
+      std::vector< std::string > expected;
+
+      for ( int i = 0; i < 500; ++i )
+      {
+        auto const token = std::string( i % 37, 'a' + i % 26 ) + "ß";
+
+        expected.push_back( token );
+        source += token + std::string( 1 + i % 3, i % 2 ? ',' : '|' );
+      }
+
+      std::vector< std::string_view > tokens;
+      for ( auto const & it : Tokenizer( source, ",|" ) )
+      {
+        tokens.push_back( it );
+      }
+
+      dessert( ( tokens.size() == expected.size() ) )
+        << hstring( "Tokenizer token count." );
+      for ( std::size_t i = 0; i < tokens.size() && i < expected.size(); ++i )
+      {
+        dessert( ( tokens[ i ] == expected[ i ] ) )
+          << hstring( "Tokenizer token contents." );
+      }
+
+      dessert( ( splitStringView( source, ",|;:-" ).size() ==
+                 expected.size() ) )
+        << hstring( "Tokenizer with many delimiters." );
+      dessert( ( splitStringView( source, "" ).size() == 1 ) )
+        << hstring( "Tokenizer without delimiters." );
+      dessert( ( splitStringView( ",,||,", ",|" ).empty() ) )
+        << hstring( "Tokenizer skips delimiter-only input." );
+
+      auto const wideSplit = splitString( L"Größe,ß|ü", L",|" );
+
+      dessert( ( wideSplit.size() == 3 && wideSplit[ 0 ] == L"Größe" &&
+                 wideSplit[ 2 ] == L"ü" ) )
+        << hstring( "splitString on multi-byte characters." );
+
+      auto const nonAsciiSplit = splitString( L"AßBßßC", L"ß" );
+
+      dessert( ( nonAsciiSplit.size() == 3 && nonAsciiSplit[ 1 ] == L"B" ) )
+        << hstring( "splitString on multi-byte delimiters." );
+    }
+
+    void runFileFilterTest()
+    {
+      dessert( ( FileFilter( ".txt" ).matches( "a.txt" ) &&
+                 ! FileFilter( ".txt" ).matches( ".txt" ) &&
+                 ! FileFilter( ".txt" ).matches( "a.png" ) ) )
+        << hstring( "Extension filter." );
+      dessert( ( FileFilter( ".*" ).matches( "anything" ) &&
+                 FileFilter( "" ).matches( "anything" ) ) )
+        << hstring( "Match-all filter." );
+      dessert( ( FileFilter( ".txt;.png" ).matches( "a.png" ) &&
+                 FileFilter( ".txt;.png" ).matches( "a.txt" ) &&
+                 ! FileFilter( ".txt;.png" ).matches( "a.jpg" ) ) )
+        << hstring( "Multi-extension filter." );
+      dessert( ( FileFilter( "log_??.txt" ).matches( "log_01.txt" ) &&
+                 ! FileFilter( "log_??.txt" ).matches( "log_1.txt" ) &&
+                 FileFilter( "*.[ch]" ).matches( "main.c" ) &&
+                 ! FileFilter( "*.[ch]" ).matches( "main.cpp" ) &&
+                 FileFilter( "*.[!c]" ).matches( "main.h" ) &&
+                 FileFilter( "[a-c]*" ).matches( "beta" ) &&
+                 ! FileFilter( "[a-c]*" ).matches( "delta" ) &&
+                 FileFilter( "*a*b*c" ).matches( "xxaxxbxxbxxc" ) &&
+                 ! FileFilter( "*a*b*c" ).matches( "xxaxxbxxcxxb" ) ) )
+        << hstring( "Glob filter." );
+      dessert( ( FileFilter::globMatches( "[a-\xFF]*", "zeta" ) &&
+                 FileFilter::globMatches( "[a-\xFF]*", "\xC3\xA9t\xC3\xA9" ) &&
+                 ! FileFilter::globMatches( "[a-\xFF]*", "Zeta" ) &&
+                 ! FileFilter::globMatches( "[!\x80-\xFF]*", "\xC3\xA9" ) ) )
+        << hstring( "Glob ranges compare bytes unsigned." );
+    }
+
+    void runTaskPoolTest()
+    {
+      TaskPool pool( 4 );
+      std::atomic< int > sum { 0 };
+      TaskGroup group( pool );
+
+      for ( int i = 0; i < 100; ++i )
+      {
+        group.run( [ &sum, &pool, i ] {
+          TaskGroup nested( pool );
+
+          for ( int j = 0; j < 10; ++j )
+          {
+            nested.run( [ &sum, i ] { sum += i; } );
+          }
+          nested.wait();
+        } );
+      }
+      group.wait();
+
+      dessert( ( sum.load() == 49500 ) ) << hstring( "Nested task groups." );
+
+      bool taskErrorRethrown = false;
+
+      group.run( [] { throw std::runtime_error( "Task failure." ); } );
+      try
+      {
+        group.wait();
+      }
+      catch ( std::runtime_error & e )
+      {
+        taskErrorRethrown = true;
+      }
+      dessert( ( taskErrorRethrown ) )
+        << hstring( "Task group rethrows task errors." );
+    }
+
+    void runColumnLoaderTest()
+    {
+      initFIOTesting();
+      fio.storePathAtID( "intFile",
+                         fio.getPath( "data" ) + PATH_SEP + "integers.txt" );
+      fio.storePathAtID( "csvFile",
+                         fio.getPath( "data" ) + PATH_SEP + "columns.csv" );
+
+      auto const integers =
+        std::get< 0 >( fio.readFileToColumns< std::int64_t >( "intFile" ) );
+
+      dessert( ( integers.size() == 100 ) )
+        << hstring( "Column loader row count." );
+      for ( std::size_t i = 0; i < integers.size(); ++i )
+      {
+        dessert( ( integers[ i ] == static_cast< std::int64_t >( i ) ) )
+          << hstring( "Column loader integer values." );
+      }
+
+      fio.openInputStream( "intFile" );
+      fio.readLine( "intFile" );
+      fio.readFileToColumns< std::int64_t >( "intFile" );
+      dessert( ( fio.readLine( "intFile" ) == "0" ) )
+        << hstring( "Column loader rewinds an open input stream." );
+      fio.closeInputStream( "intFile" );
+
+      // Large enough to be parsed in several parallel chunks.
+      int const rowCount = 200000;
+
+      fio.openOutputStream( "csvFile" );
+      for ( int i = 0; i < rowCount; ++i )
+      {
+        fio.writeLine( "csvFile",
+                       std::to_string( i ) + ", " + std::to_string( i ) +
+                         ".5,name" + std::to_string( i % 7 ) + "\r\n" );
+      }
+      fio.closeOutputStream( "csvFile" );
+
+      auto const columns =
+        fio.readFileToColumns< int, double, std::string >( "csvFile" );
+      auto const & ints = std::get< 0 >( columns );
+      auto const & reals = std::get< 1 >( columns );
+      auto const & names = std::get< 2 >( columns );
+
+      dessert( ( ints.size() == rowCount && reals.size() == rowCount &&
+                 names.size() == rowCount ) )
+        << hstring( "Parallel column loader row count." );
+
+      bool columnsInOrder = true;
+      for ( int i = 0; i < rowCount && columnsInOrder; ++i )
+      {
+        columnsInOrder = ints[ i ] == i && reals[ i ] == i + 0.5 &&
+          names[ i ] == "name" + std::to_string( i % 7 );
+      }
+      dessert( ( columnsInOrder ) )
+        << hstring( "Parallel column loader values." );
+
+      auto const runtimeColumns = fio.readFileToColumns(
+        "csvFile",
+        { ColumnType::Integer, ColumnType::Real, ColumnType::Text } );
+
+      dessert( ( runtimeColumns.size() == 3 &&
+                 std::get< std::vector< std::int64_t > >( runtimeColumns[ 0 ] )
+                     .size() == rowCount &&
+                 std::get< std::vector< double > >( runtimeColumns[ 1 ] )
+                     .back() == rowCount - 0.5 ) )
+        << hstring( "Runtime schema column loader." );
+
+      std::size_t errorRow = 0;
+      std::size_t errorColumn = 0;
+      bool badCellThrowsError = false;
+
+      try
+      {
+        fio.readFileToColumns< int, int, std::string >( "csvFile" );
+      }
+      catch ( ParseError & e )
+      {
+        badCellThrowsError = true;
+        errorRow = e.row();
+        errorColumn = e.column();
+      }
+      dessert( ( badCellThrowsError && errorRow == 0 && errorColumn == 1 ) )
+        << hstring( "Column loader reports bad cells." );
+
+      fio.openOutputStream( "csvFile", AppendToFile );
+      fio.writeLine( "csvFile", "1,2.5\n" );
+      fio.closeOutputStream( "csvFile" );
+
+      bool shortRowThrowsError = false;
+
+      try
+      {
+        fio.readFileToColumns< int, double, std::string >( "csvFile" );
+      }
+      catch ( ParseError & e )
+      {
+        shortRowThrowsError = e.row() == rowCount && e.column() == 2;
+      }
+      dessert( ( shortRowThrowsError ) )
+        << hstring( "Column loader reports short rows." );
+
+      fio.openOutputStream( "csvFile" );
+      fio.writeLine( "csvFile", "1,,x\n2,b,\n" );
+      fio.closeOutputStream( "csvFile" );
+
+      auto const emptyCells =
+        fio.readFileToColumns< int, std::string, std::string >( "csvFile" );
+
+      dessert( ( std::get< 1 >( emptyCells ) ==
+                   std::vector< std::string >{ "", "b" } &&
+                 std::get< 2 >( emptyCells ) ==
+                   std::vector< std::string >{ "x", "" } ) )
+        << hstring( "Column loader keeps empty cells." );
+
+      bool emptyCellThrowsError = false;
+
+      try
+      {
+        fio.readFileToColumns< int, int, std::string >( "csvFile" );
+      }
+      catch ( ParseError & e )
+      {
+        emptyCellThrowsError = e.row() == 0 && e.column() == 1;
+      }
+      dessert( ( emptyCellThrowsError ) )
+        << hstring( "Column loader reports empty numeric cells." );
+
+      deleteFile( fio.getPath( "csvFile" ) );
+    }
+
+    void runBufferedWriteTest()
+    {
+      initFIOTesting();
+      fio.storePathAtID( "bufferedFile",
+                         fio.getPath( "data" ) + PATH_SEP + "buffered.txt" );
+
+      // Enough lines to fill several chunks.
+      int const lineCount = 100000;
+
+      fio.openBufferedOutputStream( "bufferedFile" );
+      dessert( ( fio.hasOutputStream( "bufferedFile" ) ) )
+        << hstring( "Buffered output stream opened." );
+      for ( int i = 0; i < lineCount; ++i )
+      {
+        fio.writeLine( "bufferedFile", std::to_string( i ) + "\n" );
+      }
+      fio.flushOutputStream( "bufferedFile" );
+
+      auto lines = fio.readFileToVector( "bufferedFile" );
+      bool linesInOrder = lines.size() == lineCount;
+
+      for ( int i = 0; i < lineCount && linesInOrder; ++i )
+      {
+        linesInOrder = lines[ i ].str() == std::to_string( i );
+      }
+      dessert( ( linesInOrder ) )
+        << hstring( "Buffered output stream flushed in order." );
+
+      fio.closeOutputStream( "bufferedFile" );
+      dessert( ( ! fio.hasOutputStream( "bufferedFile" ) ) )
+        << hstring( "Buffered output stream closed." );
+
+      fio.openBufferedOutputStream( "bufferedFile", AppendToFile );
+      fio.writeLine( "bufferedFile", "appended\n" );
+      fio.syncOutputStream( "bufferedFile" );
+      fio.closeOutputStream( "bufferedFile" );
+
+      lines = fio.readFileToVector( "bufferedFile" );
+      dessert( ( lines.size() == lineCount + 1 &&
+                 lines.back() == "appended" ) )
+        << hstring( "Buffered output stream appends." );
+
+      {
+        auto const idlePath =
+          fio.getPath( "data" ) + PATH_SEP + "bufferedIdle.txt";
+        // Waits for the flusher's timer to write a partly filled chunk.
+        auto const writtenWithin = [ this,
+                                     &idlePath ]( std::string const & text ) {
+          for ( int i = 0; i < 200; ++i )
+          {
+            if ( fio.readFile( idlePath ).str() == text ) { return true; }
+            std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+          }
+          return false;
+        };
+        BufferedWriter writer( idlePath );
+
+        writer.write( "first\n" );
+        auto const firstWritten = writtenWithin( "first\n" );
+
+        // Long enough for the flusher to go back to sleep without a timer.
+        std::this_thread::sleep_for( std::chrono::milliseconds(
+          4 * BufferedWriter::FlushIntervalMilliseconds ) );
+        writer.write( "second\n" );
+        dessert( ( firstWritten && writtenWithin( "first\nsecond\n" ) ) )
+          << hstring( "Buffered output stream writes idle chunks." );
+      }
+      deleteFile( fio.getPath( "data" ) + PATH_SEP + "bufferedIdle.txt" );
+
+      fio.openBufferedOutputStream( "bufferedFile", AppendToFile );
+      fio.getBufferedOutputStream( "bufferedFile" ).write( "direct\n" );
+
+      bool wideOpenThrowsError = false;
+      bool wideGetThrowsError = false;
+
+      try
+      {
+        fio.openOutputStream( "bufferedFile" );
+      }
+      catch ( std::runtime_error & e )
+      {
+        wideOpenThrowsError = true;
+      }
+      try
+      {
+        fio.getOutputStream( "bufferedFile" );
+      }
+      catch ( std::runtime_error & e )
+      {
+        wideGetThrowsError = true;
+      }
+      fio.closeOutputStream( "bufferedFile" );
+      dessert( ( wideOpenThrowsError && wideGetThrowsError ) )
+        << hstring( "Buffered output stream rejects wide access." );
+
+      lines = fio.readFileToVector( "bufferedFile" );
+      dessert( ( lines.size() == lineCount + 2 && lines.back() == "direct" ) )
+        << hstring( "Buffered output stream retrieved." );
+
+      fio.openOutputStream( "bufferedFile", AppendToFile );
+
+      bool bufferedOpenThrowsError = false;
+      bool bufferedGetThrowsError = false;
+
+      try
+      {
+        fio.openBufferedOutputStream( "bufferedFile" );
+      }
+      catch ( std::runtime_error & e )
+      {
+        bufferedOpenThrowsError = true;
+      }
+      try
+      {
+        fio.getBufferedOutputStream( "bufferedFile" );
+      }
+      catch ( std::runtime_error & e )
+      {
+        bufferedGetThrowsError = true;
+      }
+      fio.closeOutputStream( "bufferedFile" );
+      dessert( ( bufferedOpenThrowsError && bufferedGetThrowsError ) )
+        << hstring( "Wide output stream rejects buffered access." );
+
+      int const threadCount = 4;
+      int const linesPerThread = 20000;
+
+      {
+        // A small pending limit, so writers also wait on the flusher.
+        BufferedWriter writer(
+          fio.getPath( "bufferedFile" ), OpenNewFile, 1 << 16 );
+        std::vector< std::thread > writers;
+
+        for ( int t = 0; t < threadCount; ++t )
+        {
+          writers.emplace_back( [ &writer, t ] {
+            for ( int i = 0; i < linesPerThread; ++i )
+            {
+              writer.write( std::to_string( t ) + ":" + std::to_string( i ) +
+                            "\n" );
+            }
+          } );
+        }
+        for ( auto & it : writers ) { it.join(); }
+      }
+
+      lines = fio.readFileToVector( "bufferedFile" );
+
+      std::vector< int > nextLine( threadCount, 0 );
+      bool threadLinesInOrder = lines.size() == threadCount * linesPerThread;
+
+      for ( auto const & it : lines )
+      {
+        auto const line = it.str();
+        auto const t = std::stoi( line.substr( 0, line.find( ':' ) ) );
+
+        if ( line != std::to_string( t ) + ":" +
+                       std::to_string( nextLine[ t ]++ ) )
+        {
+          threadLinesInOrder = false;
+          break;
+        }
+      }
+      dessert( ( threadLinesInOrder ) )
+        << hstring( "Concurrent buffered writes kept whole and in order." );
+
+      deleteFile( fio.getPath( "bufferedFile" ) );
+    }
+
+    void runConcurrencyStressTest()
+    {
+      initFIOTesting();
+      fio.storePathAtID( "sharedFile",
+                         fio.getPath( "data" ) + PATH_SEP + "shared.txt" );
+      fio.openOutputStream( "sharedFile" );
+
+      int const threadCount = 8;
+      int const linesPerThread = 2000;
+      auto const dataPath = fio.getPath( "data" );
+      std::atomic< bool > pathsConsistent { true };
+      std::atomic< bool > linesReadBack { true };
+      std::vector< std::thread > workers;
+
+      for ( int t = 0; t < threadCount; ++t )
+      {
+        workers.emplace_back( [ this, t, &dataPath, &pathsConsistent,
+                                &linesReadBack, linesPerThread ] {
+          auto const ID = "stressFile" + std::to_string( t );
+
+          fio.storePathAtID( ID,
+                             dataPath + PATH_SEP + "stress" +
+                               std::to_string( t ) + ".txt" );
+          fio.openOutputStream( ID );
+          for ( int i = 0; i < linesPerThread; ++i )
+          {
+            auto const line = std::to_string( t ) + ":" + std::to_string( i );
+
+            fio.writeLine( ID, line + "\n" );
+            fio.writeLine( "sharedFile", line + "\n" );
+
+            // Churn the Path Map while other threads are reading it.
+            fio.storePathAtID( "churn" + std::to_string( t ), line );
+            if ( fio.getPath( "data" ).str() != dataPath.str() )
+            {
+              pathsConsistent = false;
+            }
+          }
+          fio.closeOutputStream( ID );
+
+          fio.openInputStream( ID );
+          for ( int i = 0; i < linesPerThread; ++i )
+          {
+            if ( fio.readLine( ID ).str() !=
+                 std::to_string( t ) + ":" + std::to_string( i ) )
+            {
+              linesReadBack = false;
+            }
+          }
+          fio.closeInputStream( ID );
+          deleteFile( fio.getPath( ID ) );
+          fio.removePathAtID( ID );
+        } );
+      }
+      for ( auto & it : workers ) { it.join(); }
+      fio.closeOutputStream( "sharedFile" );
+
+      dessert( ( pathsConsistent.load() ) )
+        << hstring( "Path IDs stay readable while being changed." );
+      dessert( ( linesReadBack.load() ) )
+        << hstring( "Concurrent streams on separate files." );
+
+      bool churnStored = true;
+      for ( int t = 0; t < threadCount; ++t )
+      {
+        churnStored = churnStored &&
+          fio.getPath( "churn" + std::to_string( t ) ).str() ==
+            std::to_string( t ) + ":" + std::to_string( linesPerThread - 1 );
+      }
+      dessert( ( churnStored ) )
+        << hstring( "Concurrent Path Map changes are all kept." );
+
+      auto const lines = fio.readFileToVector( "sharedFile" );
+      std::vector< int > nextLine( threadCount, 0 );
+      bool sharedLinesInOrder = lines.size() == threadCount * linesPerThread;
+
+      for ( std::size_t i = 0; i < lines.size() && sharedLinesInOrder; ++i )
+      {
+        auto const line = lines[ i ].str();
+        auto const t = std::stoi( line.substr( 0, line.find( ':' ) ) );
+
+        sharedLinesInOrder = line == std::to_string( t ) + ":" +
+          std::to_string( nextLine[ t ]++ );
+      }
+      dessert( ( sharedLinesInOrder ) )
+        << hstring( "Concurrent writes to one stream kept whole." );
+
+      deleteFile( fio.getPath( "sharedFile" ) );
+
+      fio.storePathAtID( "raceFile", dataPath + PATH_SEP + "race.txt" );
+      fio.openOutputStream( "raceFile" );
+
+      std::atomic< int > raceLinesWritten { 0 };
+      workers.clear();
+      for ( int t = 0; t < threadCount; ++t )
+      {
+        workers.emplace_back( [ this, &raceLinesWritten ] {
+          try
+          {
+            while ( true )
+            {
+              fio.writeLine( "raceFile", "line\n" );
+              ++raceLinesWritten;
+            }
+          }
+          catch ( std::runtime_error & e )
+          {
+          }
+        } );
+      }
+      std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+      fio.closeOutputStream( "raceFile" );
+
+      auto const raceLines = fio.readFileToVector( "raceFile" ).size();
+
+      for ( auto & it : workers ) { it.join(); }
+      dessert( ( raceLines == static_cast< std::size_t >(
+                                raceLinesWritten.load() ) ) )
+        << hstring( "Writes racing a close finish before it or throw." );
+      deleteFile( fio.getPath( "raceFile" ) );
+
+      std::atomic< bool > clearing { true };
+      std::atomic< bool > rootKept { true };
+      auto const rootDir = fio.getRootDir();
+      std::thread reader( [ this, &clearing, &rootKept, &rootDir ] {
+        while ( clearing )
+        {
+          if ( fio.getRootDir() != rootDir ) { rootKept = false; }
+        }
+      } );
+
+      for ( int i = 0; i < 200; ++i ) { fio.clear(); }
+      clearing = false;
+      reader.join();
+      dessert( ( rootKept.load() ) )
+        << hstring( "The root dir stays set while clearing." );
+    }
+
+    void runPathHandleTest()
+    {
+      initFIOTesting();
+      fio.storePathAtID( "handleFile",
+                         fio.getPath( "data" ) + PATH_SEP + "handle.txt" );
+
+      auto const handle = fio.getHandle( "handleFile" );
+
+      dessert( ( handle && handle == fio.getHandle( fio.getPath( "data" ) +
+                                                    PATH_SEP + "handle.txt" ) &&
+                 handle != fio.getHandle( "data" ) && ! PathHandle() ) )
+        << hstring( "Handles are interned by path." );
+      dessert( ( handle.path() == fio.getPath( "handleFile" ) ) )
+        << hstring( "Handle path." );
+
+      fio.openOutputStream( handle );
+      dessert( ( fio.hasOutputStream( "handleFile" ) ) )
+        << hstring( "Handle streams are shared with pathOrID streams." );
+      for ( int i = 0; i < 100; ++i )
+      {
+        fio.writeLine( handle, std::to_string( i ) + "\n" );
+      }
+      fio.closeOutputStream( "handleFile" );
+      dessert( ( ! fio.hasOutputStream( handle ) ) )
+        << hstring( "Closing by pathOrID closes the handle's stream." );
+
+      fio.openInputStream( "handleFile" );
+
+      bool linesInOrder = true;
+      for ( int i = 0; i < 100; ++i )
+      {
+        linesInOrder = linesInOrder &&
+          fio.readLine( handle ).str() == std::to_string( i );
+      }
+      fio.rewindInputStream( handle );
+      dessert( ( linesInOrder && fio.readLine( handle ) == "0" ) )
+        << hstring( "Reading and rewinding through a handle." );
+
+      fio.clear();
+      dessert( ( ! fio.hasInputStream( handle ) ) )
+        << hstring( "Clearing closes handle streams." );
+
+      bool closedHandleThrowsError = false;
+
+      try
+      {
+        fio.readLine( handle );
+      }
+      catch ( std::runtime_error & e )
+      {
+        closedHandleThrowsError = true;
+      }
+      dessert( ( closedHandleThrowsError ) )
+        << hstring( "Reading a closed handle stream." );
+
+      deleteFile( handle.path() );
+
+      PathTable table;
+      auto const kept = table.intern( "kept" );
+
+      for ( int i = 0; i < 10000; ++i )
+      {
+        table.intern( "path" + std::to_string( i ) );
+      }
+      dessert( ( table.size() < 2000 && table.find( "kept" ) == kept ) )
+        << hstring( "Unused paths are swept as the table grows." );
+
+      table.intern( "released" );
+      table.release( "released" );
+      table.release( "kept" );
+      dessert( ( ! table.find( "released" ) && table.find( "kept" ) ) )
+        << hstring( "Released paths are freed unless in use." );
+
+      table.prune();
+      dessert( ( table.size() == 1 ) )
+        << hstring( "Pruning frees every unused path." );
+    }
+
+    void runDirectoryIndexTest()
+    {
+      initFIOTesting();
+
+      auto const dataPath = fio.getPath( "data" );
+      auto const indexFile = fio.getRootDir() + PATH_SEP + "data.index";
+      auto const newFile =
+        dataPath + PATH_SEP + "data1" + PATH_SEP + "indexed.txt";
+      auto const sorted = []( std::vector< hstring > files ) {
+        std::sort( files.begin(),
+                   files.end(),
+                   []( hstring const & a, hstring const & b ) {
+                     return a.str() < b.str();
+                   } );
+        return files;
+      };
+      // Waits for the index watcher to catch up with a change.
+      auto const indexed = [ this ]( hstring const & file ) {
+        for ( int i = 0; i < 200; ++i )
+        {
+          auto const files = fio.findFiles( ".txt", "data" );
+
+          if ( std::find( files.begin(), files.end(), file ) != files.end() )
+          {
+            return true;
+          }
+          std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+        }
+        return false;
+      };
+
+      auto const walked = sorted( fio.findFiles( ".*", "data" ) );
+      auto & index = fio.indexDirectory( "data" );
+
+      dessert( ( sorted( fio.findFiles( ".*", "data" ) ) == walked &&
+                 index.fileCount() == walked.size() ) )
+        << hstring( "Directory index matches a directory walk." );
+      auto const topLevel =
+        fio.findFiles( ".txt", "data", RecursiveSearchFalse );
+
+      dessert( ( topLevel.size() == 1 &&
+                 topLevel[ 0 ] == dataPath + PATH_SEP + "integers.txt" ) )
+        << hstring( "Directory index non-recursive search." );
+
+      fio.openOutputStream( newFile );
+      fio.writeLine( newFile, "12345" );
+      fio.closeOutputStream( newFile );
+
+#ifdef __linux__
+      dessert( ( indexed( newFile ) ) )
+        << hstring( "Directory index picks up new files." );
+
+      auto size = 0;
+      for ( int i = 0; i < 200 && size != 5; ++i )
+      {
+        auto const file = index.findFile( newFile );
+        size = file ? static_cast< int >( file->size ) : 0;
+        std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+      }
+      dessert( ( size == 5 ) ) << hstring( "Directory index file sizes." );
+
+      deleteFile( newFile );
+      bool removed = false;
+      for ( int i = 0; i < 200 && ! removed; ++i )
+      {
+        removed = ! index.findFile( newFile );
+        std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+      }
+      dessert( ( removed ) )
+        << hstring( "Directory index drops deleted files." );
+#else
+      index.rescan();
+      dessert( ( indexed( newFile ) ) )
+        << hstring( "Directory index picks up new files." );
+      deleteFile( newFile );
+      index.rescan();
+#endif
+
+      index.save( indexFile );
+      fio.removeDirectoryIndex( "data" );
+
+      fio.openOutputStream( newFile );
+      fio.closeOutputStream( newFile );
+
+      auto & loaded =
+        fio.loadDirectoryIndex( "data", indexFile, WatchChangesFalse );
+
+      dessert( ( indexed( newFile ) &&
+                 loaded.fileCount() == walked.size() + 1 ) )
+        << hstring( "Loaded directory index re-reads changed directories." );
+
+      deleteFile( newFile );
+      fio.removeDirectoryIndex( "data" );
+
+      bool wrongDirectoryThrowsError = false;
+
+      try
+      {
+        fio.loadDirectoryIndex( dataPath + PATH_SEP + "data1", indexFile );
+      }
+      catch ( std::runtime_error & e )
+      {
+        wrongDirectoryThrowsError = true;
+      }
+      dessert( ( wrongDirectoryThrowsError ) )
+        << hstring( "Directory index loaded for the wrong directory." );
+
+      auto & unwatched =
+        fio.indexDirectory( dataPath + PATH_SEP, WatchChangesFalse );
+
+      fio.openOutputStream( newFile );
+      fio.closeOutputStream( newFile );
+
+      auto files = fio.findFiles( ".txt", "data" );
+
+      dessert( ( std::find( files.begin(), files.end(), newFile ) ==
+                   files.end() &&
+                 ! unwatched.degraded() ) )
+        << hstring( "Directory indexes ignore trailing separators." );
+
+      unwatched.rescan();
+      dessert( ( indexed( newFile ) ) )
+        << hstring( "Directory index rescan." );
+
+      deleteFile( newFile );
+      fio.removeDirectoryIndex( dataPath + PATH_SEP + PATH_SEP );
+      files = fio.findFiles( ".txt", "data" );
+      dessert( ( std::find( files.begin(), files.end(), newFile ) ==
+                 files.end() ) )
+        << hstring( "Directory indexes are removed by any spelling." );
+
+      deleteFile( indexFile );
+
+#ifndef WINDOWS
+      // A link back up to the top of the tree, which is followed once. Two
+      // links to one directory are not used, as the walk follows whichever
+      // it reaches first.
+      auto const linkTree = fio.getRootDir() + PATH_SEP + "linkTree";
+      auto const realDir = linkTree + PATH_SEP + "real";
+      auto const linkFile = realDir + PATH_SEP + "file.txt";
+
+      ::mkdir( linkTree.mb_str(), 0755 );
+      ::mkdir( realDir.mb_str(), 0755 );
+      fio.openOutputStream( linkFile );
+      fio.closeOutputStream( linkFile );
+      dessert( ( ::symlink( "..", ( realDir + "/up" ).mb_str() ) == 0 ) )
+        << hstring( "Linked directory created." );
+
+      auto const linkWalked = sorted( fio.findFiles( ".*", linkTree ) );
+      auto & linkIndex = fio.indexDirectory( linkTree );
+
+      dessert( ( linkWalked.size() == 2 &&
+                 sorted( fio.findFiles( ".*", linkTree ) ) == linkWalked ) )
+        << hstring( "Directory index follows linked directories." );
+      linkIndex.rescan();
+      dessert( ( sorted( fio.findFiles( ".*", linkTree ) ) == linkWalked ) )
+        << hstring( "Directory index rescan follows linked directories." );
+
+      fio.removeDirectoryIndex( linkTree );
+      ::unlink( ( realDir + "/up" ).mb_str() );
+      deleteFile( linkFile );
+      ::rmdir( realDir.mb_str() );
+      ::rmdir( linkTree.mb_str() );
+#endif
+    }
+
+    void runRecordReaderTest()
+    {
+      initFIOTesting();
+      fio.storePathAtID( "recordFile",
+                         fio.getPath( "data" ) + PATH_SEP + "records.txt" );
+
+      // Lines both shorter and longer than the buffers, with empty lines.
+      fio.openOutputStream( "recordFile" );
+      for ( int i = 0; i < 2000; ++i )
+      {
+        fio.writeLine( "recordFile",
+                       std::to_string( i ) + std::string( i % 150, 'x' ) +
+                         ( i % 7 == 0 ? "\r\n\r\n" : "\n" ) );
+      }
+      fio.writeLine( "recordFile", "last" );
+      fio.closeOutputStream( "recordFile" );
+
+      auto const expected = fio.readFileToVector( "recordFile" );
+      std::size_t recordCount = 0;
+      bool recordsMatch = true;
+
+      for ( auto const & it :
+            RecordReader( fio.getPath( "recordFile" ), "\n\r", 64, 3 ) )
+      {
+        recordsMatch = recordsMatch && recordCount < expected.size() &&
+          it == expected[ recordCount ].str();
+        ++recordCount;
+      }
+      dessert( ( recordsMatch && recordCount == expected.size() &&
+                 expected.back() == "last" ) )
+        << hstring( "Records crossing buffer boundaries." );
+
+      recordCount = 0;
+      for ( auto const & it : fio.readRecords( "recordFile", "x" ) )
+      {
+        recordsMatch = recordsMatch && ! it.empty();
+        ++recordCount;
+      }
+      dessert( ( recordsMatch &&
+                 recordCount == fio.readFileToVector( "recordFile", "x" )
+                                  .size() ) )
+        << hstring( "Records split on other delimiters." );
+
+      fio.openOutputStream( "recordFile" );
+      fio.closeOutputStream( "recordFile" );
+
+      auto emptyFile = fio.readRecords( "recordFile" );
+      dessert( ( emptyFile.begin() == emptyFile.end() ) )
+        << hstring( "Empty files have no records." );
+
+      deleteFile( fio.getPath( "recordFile" ) );
+    }
+
+    void runBatchReadTest()
+    {
+      initFIOTesting();
+
+      int const fileCount = 50;
+      std::vector< hstring > files;
+
+      for ( int i = 0; i < fileCount; ++i )
+      {
+        files.push_back( fio.getPath( "data" ) + PATH_SEP + "data2" +
+                         PATH_SEP + std::to_string( i ) + ".batch" );
+        fio.openOutputStream( files.back() );
+        fio.writeLine( files.back(), "file " + std::to_string( i ) );
+        fio.closeOutputStream( files.back() );
+      }
+      files.push_back( fio.getPath( "data" ) + PATH_SEP + "missing.batch" );
+
+      auto const results = fio.readFiles( files, 4 );
+      bool resultsInOrder = results.size() == files.size();
+
+      for ( int i = 0; i < fileCount && resultsInOrder; ++i )
+      {
+        resultsInOrder = results[ i ] && results[ i ].path == files[ i ] &&
+          results[ i ].contents == "file " + std::to_string( i );
+      }
+      dessert( ( resultsInOrder ) )
+        << hstring( "Batch reads return results in order." );
+      dessert( ( ! results.back() && results.back().error ) )
+        << hstring( "Batch reads report errors per file." );
+
+      std::size_t callbackCount = 0;
+      std::size_t nestedReads = 0;
+      auto const caller = std::this_thread::get_id();
+      auto const filesRead = fio.readFiles(
+        [ this, &callbackCount, &nestedReads, &caller ]( FileContents && f ) {
+          callbackCount += std::this_thread::get_id() == caller;
+          if ( f && fio.readFiles( { f.path } ).front() ) { ++nestedReads; }
+        },
+        files );
+
+      dessert( ( filesRead == fileCount && callbackCount == files.size() ) )
+        << hstring( "Batch reads with a completion callback." );
+      dessert( ( nestedReads == fileCount ) )
+        << hstring( "Batch read callbacks may read files themselves." );
+      dessert( ( fio.readFiles( ".batch", "data" ).size() == fileCount &&
+                 fio.readFiles( ".batch", "data", RecursiveSearchTrue, 1 )
+                     .size() == fileCount ) )
+        << hstring( "Batch reads of a file search." );
+
+      for ( int i = 0; i < fileCount; ++i ) { deleteFile( files[ i ] ); }
+    }
+
+    void runStatsTest()
+    {
+      initFIOTesting();
+
+      auto const path = fio.getPath( "data" ) + PATH_SEP + "stats.txt";
+
+      fio.storePathAtID( "statsFile", path );
+      fio.enableStats();
+      fio.openOutputStream( path );
+      fio.writeLine( path, "one\ntwo\n" );
+      fio.closeOutputStream( path );
+      fio.openInputStream( "statsFile" );
+      fio.readLine( "statsFile" );
+      fio.closeInputStream( "statsFile" );
+      std::thread( [ this, &path ] { fio.readFile( path ); } ).join();
+      fio.findFiles( ".txt", "data" );
+
+      auto const stats = fio.stats();
+
+#ifdef FIO_ENABLE_STATS
+      auto const found = stats.paths.find( path.str() );
+      auto const data = stats.paths.find( fio.getPath( "data" ).str() );
+
+      dessert( ( fio.statsEnabled() && stats.enabled &&
+                 found != stats.paths.end() ) )
+        << hstring( "Statistics are recorded per path." );
+      dessert( ( found->second.opens == 2 && found->second.closes == 2 &&
+                 found->second.readLineCalls == 1 &&
+                 found->second.writeLineCalls == 1 &&
+                 found->second.readFileCalls == 1 ) )
+        << hstring( "Statistics count calls on every thread." );
+      dessert( ( found->second.bytesWritten == 8 &&
+                 found->second.bytesRead == 3 + 8 ) )
+        << hstring( "Statistics count bytes read and written." );
+      dessert( ( found->second.IDs == std::vector< std::string >{
+                   "statsFile" } ) )
+        << hstring( "Statistics name the IDs of each path." );
+      dessert( ( data != stats.paths.end() &&
+                 data->second.findFilesCalls == 1 &&
+                 data->second.directoriesVisited >= 2 ) )
+        << hstring( "Statistics count the directories findFiles visits." );
+      dessert( ( stats.latency( IOOperation::ReadLine ).count == 1 &&
+                 stats.latency( IOOperation::Open ).count == 2 &&
+                 stats.latency( IOOperation::ReadFile ).percentile( 99 ) >=
+                   stats.latency( IOOperation::ReadFile ).percentile( 50 ) ) )
+        << hstring( "Statistics keep latency histograms per operation." );
+      dessert( ( stats.toJSON().find( "\"statsFile\"" ) != std::string::npos &&
+                 stats.toText().find( "readFile 1" ) != std::string::npos ) )
+        << hstring( "Statistics dump as JSON and text." );
+#else
+      dessert( ( ! fio.statsEnabled() && ! stats.enabled &&
+                 stats.paths.empty() ) )
+        << hstring( "Statistics compiled out record nothing." );
+#endif
+
+      fio.resetStats();
+      dessert( ( fio.stats().paths.empty() &&
+                 fio.stats().latency( IOOperation::ReadFile ).count == 0 ) )
+        << hstring( "Statistics reset." );
+
+#ifdef FIO_ENABLE_STATS
+      auto const bufferedPath =
+        fio.getPath( "data" ) + PATH_SEP + "statsBuffered.txt";
+
+      fio.readFileToVector( path );
+      fio.readFileToMatrix( path );
+      fio.readFileToColumns< std::string >( path );
+      fio.readRecords( path );
+      fio.readFiles( { path, path } );
+      fio.openBufferedOutputStream( bufferedPath );
+      fio.writeLine( bufferedPath, "abc\n" );
+      fio.getBufferedOutputStream( bufferedPath ).write( "de\n" );
+      fio.closeOutputStream( bufferedPath );
+
+      auto const covered = fio.stats();
+      auto const file = covered.paths.find( path.str() );
+      auto const buffered = covered.paths.find( bufferedPath.str() );
+
+      dessert( ( file != covered.paths.end() &&
+                 file->second.readFileCalls == 6 &&
+                 file->second.bytesRead == 5 * 8 ) )
+        << hstring( "Statistics count every whole file read." );
+      dessert( ( buffered != covered.paths.end() &&
+                 buffered->second.writeLineCalls == 2 &&
+                 buffered->second.bytesWritten == 7 ) )
+        << hstring( "Statistics count buffered writes." );
+      deleteFile( bufferedPath );
+
+      fio.resetStats();
+      for ( int i = 0; i < 40; ++i )
+      {
+        std::thread( [ this, &path ] { fio.readFile( path ); } ).join();
+      }
+      dessert( ( fio.stats().paths[ path.str() ].readFileCalls == 40 ) )
+        << hstring( "Statistics of exited threads are kept." );
+      fio.resetStats();
+#endif
+
+      fio.enableStats( false );
+      fio.readFile( path );
+      dessert( ( fio.stats().paths.empty() ) )
+        << hstring( "Statistics are not recorded while turned off." );
+
+      fio.removePathAtID( "statsFile" );
+      deleteFile( path );
+    }
+
+    void runSyntaxHandlerTest()
+    {
+      SyntaxHandler syntax;
+      std::string const text = "  the  quick\t\t brown \"fox\" jumps over "
+                               "the lazy dog, THE END  ";
+
+      std::string upper = text;
+      syntax.makeUpperCase( upper );
+      dessert( ( upper == "  THE  QUICK\t\t BROWN \"FOX\" JUMPS OVER THE LAZY "
+                          "DOG, THE END  " ) )
+        << hstring( "SyntaxHandler upper cases." );
+
+      std::string lower = upper;
+      syntax.makeLowerCase( lower );
+      dessert( ( lower == "  the  quick\t\t brown \"fox\" jumps over the lazy "
+                          "dog, the end  " ) )
+        << hstring( "SyntaxHandler lower cases." );
+
+      std::string title = " the QUICK \"brown\" fox";
+      syntax.makeTitleCase( title );
+      dessert( ( title == "Quick \"Brown\" Fox, The " ) )
+        << hstring( "SyntaxHandler title cases." );
+
+      std::string trimmed = text;
+      syntax.trimWhiteSpace( trimmed );
+      dessert( ( trimmed == " the quick\tbrown \"fox\" jumps over the lazy "
+                            "dog, THE END " ) )
+        << hstring( "SyntaxHandler collapses whitespace." );
+
+      std::string empty;
+      syntax.trimWhiteSpace( empty );
+      dessert( ( empty.empty() ) )
+        << hstring( "SyntaxHandler trims empty strings." );
+
+      dessert( ( syntax.splitString( "a, ,b,,c ", ',' ) ==
+                 std::vector< std::string >{ "a", "b", "c " } ) )
+        << hstring( "SyntaxHandler splits, skipping blank tokens." );
+      dessert( ( syntax.splitStringsInQuotes( "play \"a b\" \" \" now \"x" ) ==
+                 std::vector< std::string >{
+                   "play ", "\"a b\"", " now ", "x" } ) )
+        << hstring( "SyntaxHandler splits around quotes." );
+      dessert( ( syntax.splitStringView( "a,b", ',' ).size() == 2 &&
+                 syntax.splitStringsInQuotesView( "a\"b\"" ).back() ==
+                   "\"b\"" ) )
+        << hstring( "SyntaxHandler splits into views." );
+
+      dessert( ( syntax.startsWith( text, "  the" ) &&
+                 ! syntax.startsWith( "the", "theme" ) &&
+                 syntax.endsWith( std::string( "file.txt" ), ".txt" ) &&
+                 ! syntax.endsWith( "txt", ".txt" ) ) )
+        << hstring( "SyntaxHandler checks prefixes and suffixes." );
+
+      std::vector< std::string > records = { " the end", "  A  B ", "" };
+      syntax.makeTitleCase( records );
+      dessert( ( records == std::vector< std::string >{
+                              "End, The ", " A  B ", "" } ) )
+        << hstring( "SyntaxHandler title cases records." );
+
+      std::string arena = "  a  b \n\nthe  c";
+      syntax.trimWhiteSpace( arena, '\n' );
+      dessert( ( arena == " a b \n\nthe c" ) )
+        << hstring( "SyntaxHandler trims the records of an arena." );
+      syntax.makeTitleCase( arena, '\n' );
+      dessert( ( arena == "A B \n\nC, The " ) )
+        << hstring( "SyntaxHandler title cases the records of an arena." );
+    }
+
+    void runFileTransferTest()
+    {
+      initFIOTesting();
+
+      auto const dir = fio.getPath( "data" ) + PATH_SEP;
+      auto const source = dir + "transfer.txt";
+      auto const copy = dir + "transfer.copy";
+      auto const moved = dir + "transfer.moved";
+      auto const countFiles = [ this ] {
+        return fio.findFiles( ".*", "data", RecursiveSearchFalse ).size();
+      };
+      auto const filesBefore = countFiles();
+
+      fio.atomicWriteFile( source, "first" );
+      fio.atomicWriteFile( source, "second,\n" );
+      dessert( ( fio.readFile( source ) == "second,\n" ) )
+        << hstring( "Atomic writes replace the file." );
+
+      std::string large( 3 << 20, '\0' );
+      for ( std::size_t i = 0; i < large.size(); ++i )
+      {
+        large[ i ] = static_cast< char >( i * 7 % 251 );
+      }
+      fio.atomicWriteFile( source, large );
+      dessert( ( fio.readFile( source ).str() == large ) )
+        << hstring( "Atomic writes keep bytes unaltered." );
+
+      fio.storePathAtID( "transferCopy", copy );
+      fio.copyFile( source, "transferCopy" );
+      dessert( ( fio.readFile( copy ).str() == large ) )
+        << hstring( "Copied files match their source." );
+      fio.atomicWriteFile( source, "" );
+      fio.copyFile( source, "transferCopy" );
+      dessert( ( fio.readFile( copy ).str().empty() ) )
+        << hstring( "Copies replace the destination." );
+
+      bool openStreamThrows = false;
+      fio.openInputStream( copy );
+      try
+      {
+        fio.moveFile( copy, moved );
+      }
+      catch ( std::runtime_error const & e )
+      {
+        openStreamThrows = true;
+      }
+      fio.closeInputStream( copy );
+      dessert( ( openStreamThrows && fio.readFile( copy ).str().empty() ) )
+        << hstring( "Moving a file with an open stream throws error." );
+
+      fio.moveFile( copy, moved );
+      dessert( ( fio.findFiles( ".copy", "data", RecursiveSearchFalse )
+                   .empty() &&
+                 fio.findFiles( ".moved", "data", RecursiveSearchFalse )
+                     .size() == 1 ) )
+        << hstring( "Moved files leave their source." );
+      dessert( ( countFiles() == filesBefore + 2 ) )
+        << hstring( "Transfers leave no temporary files." );
+
+      bool missingSourceThrows = false;
+      try
+      {
+        fio.copyFile( dir + "missing.txt", copy );
+      }
+      catch ( std::system_error const & e )
+      {
+        missingSourceThrows = true;
+      }
+      dessert( ( missingSourceThrows && countFiles() == filesBefore + 2 ) )
+        << hstring( "Copying a missing file throws error." );
+
+      fio.removePathAtID( "transferCopy" );
+      deleteFile( source );
+      deleteFile( moved );
+    }
+
     void runAllUnitTests()
     {
       runStringConstructionTests();
@@ -816,6 +2138,20 @@ namespace FIOTests
       runBasicWriteTest();
       runExtendedReadWriteTest();
       runFileSearchTest();
+      runMappedFileTest();
+      runTokenizerTest();
+      runFileFilterTest();
+      runTaskPoolTest();
+      runColumnLoaderTest();
+      runBufferedWriteTest();
+      runConcurrencyStressTest();
+      runPathHandleTest();
+      runDirectoryIndexTest();
+      runRecordReaderTest();
+      runBatchReadTest();
+      runStatsTest();
+      runSyntaxHandlerTest();
+      runFileTransferTest();
     }
 
     private:
@@ -8,6 +8,7 @@
 #define SyntaxHandlerHeader
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <algorithm>
 #include <functional>
@@ -25,6 +26,9 @@ public:
 
     /*
     * String manipulation functions
+    *
+    * ASCII text is processed 16 bytes at a time where SSE2 is available,
+    * other bytes follow the current C locale.
     */
 
     void makeUpperCase( std::string & in ) const;
@@ -35,18 +39,45 @@ public:
     std::string centerString( std::string const & str,
         int const targetSize ) const;
 
-    std::vector<std::string> splitString( std::string str,
+    std::vector<std::string> splitString( std::string const & str,
         char const & charToSplitOn ) const;
-    std::vector<std::string> splitStringsInQuotes( std::string str ) const;
+    std::vector<std::string> splitStringsInQuotes(
+        std::string const & str ) const;
+
+    /*
+    * Splitting functions returning views into str, following the same rules
+    * as splitString and splitStringsInQuotes.
+    */
+
+    std::vector<std::string_view> splitStringView( std::string_view str,
+        char const & charToSplitOn ) const;
+    std::vector<std::string_view> splitStringsInQuotesView(
+        std::string_view str ) const;
+
+    /*
+    * Batch string manipulation functions, applied to every record of a
+    * vector, or of an arena holding records separated by recordDelim. As
+    * records are independent, makeUpperCase and makeLowerCase on an arena
+    * are the single string calls.
+    */
+
+    void makeUpperCase( std::vector<std::string> & records ) const;
+    void makeLowerCase( std::vector<std::string> & records ) const;
+    void makeTitleCase( std::vector<std::string> & records ) const;
+    void trimWhiteSpace( std::vector<std::string> & records ) const;
+    void makeTitleCase( std::string & arena, char const & recordDelim ) const;
+    void trimWhiteSpace( std::string & arena, char const & recordDelim ) const;
 
     /*
     * String analysis functions
     */
 
+    bool startsWith( std::string_view in, std::string_view prefix ) const;
     bool startsWith( std::string const & in, std::string const & prefix ) const;
     bool startsWith( char const * const & in,
         char const * const & prefix ) const;
 
+    bool endsWith( std::string_view in, std::string_view suffix ) const;
     bool endsWith( std::string const & in, std::string const & suffix ) const;
     bool endsWith( char const * const & in,
         char const * const & suffix ) const;
@@ -6,6 +6,316 @@
 
 #include "SyntaxHandler.hxx"
 
+#if defined __SSE2__ || defined _M_X64 || \
+  ( defined _M_IX86_FP && _M_IX86_FP >= 2 )
+  #define SYNTAX_HANDLER_SSE2
+  #include <emmintrin.h>
+#endif
+
+namespace
+{
+  /*
+  * Whether the current C locale maps ASCII letters like the "C" locale, so
+  * that ASCII text may skip the locale. Turkish locales map 'i' elsewhere.
+  */
+  bool plainAsciiCase()
+  {
+    return std::toupper( 'i' ) == 'I' && std::tolower( 'I' ) == 'i';
+  }
+
+  char toUpper( char const c )
+  {
+    return static_cast< char >(
+      std::toupper( static_cast< unsigned char >( c ) ) );
+  }
+
+  char toLower( char const c )
+  {
+    return static_cast< char >(
+      std::tolower( static_cast< unsigned char >( c ) ) );
+  }
+
+  bool isSpace( char const c )
+  {
+    return std::isspace( static_cast< unsigned char >( c ) ) != 0;
+  }
+
+  bool isWordStart( char const previous )
+  {
+    return previous == ' ' || previous == '\"';
+  }
+
+#ifdef SYNTAX_HANDLER_SSE2
+  // Mask of the bytes of chunk within [ first, last ], for ASCII bytes.
+  __m128i asciiRange( __m128i const chunk, char const first, char const last )
+  {
+    return _mm_and_si128( _mm_cmpgt_epi8( chunk, _mm_set1_epi8( first - 1 ) ),
+      _mm_cmplt_epi8( chunk, _mm_set1_epi8( last + 1 ) ) );
+  }
+
+  // Mask of the ASCII whitespace bytes of chunk.
+  __m128i asciiSpace( __m128i const chunk )
+  {
+    return _mm_or_si128( _mm_cmpeq_epi8( chunk, _mm_set1_epi8( ' ' ) ),
+      asciiRange( chunk, '\t', '\r' ) );
+  }
+#endif
+
+  void mapCase( char * const data, std::size_t const size, bool const upper,
+    bool const plainAscii )
+  {
+    std::size_t i = 0;
+
+#ifdef SYNTAX_HANDLER_SSE2
+    char const first = upper ? 'a' : 'A';
+
+    for( ; plainAscii && i + 16 <= size; i += 16 )
+    {
+      __m128i chunk =
+        _mm_loadu_si128( reinterpret_cast< __m128i const * >( data + i ) );
+
+      if( _mm_movemask_epi8( chunk ) != 0 )
+      {
+        for( std::size_t j = i; j < i + 16; j++ )
+        {
+          data[ j ] = upper ? toUpper( data[ j ] ) : toLower( data[ j ] );
+        }
+
+        continue;
+      }
+
+      chunk = _mm_xor_si128( chunk, _mm_and_si128(
+        asciiRange( chunk, first, first + 25 ), _mm_set1_epi8( 0x20 ) ) );
+      _mm_storeu_si128( reinterpret_cast< __m128i * >( data + i ), chunk );
+    }
+#endif
+
+    for( ; i < size; i++ )
+    {
+      data[ i ] = upper ? toUpper( data[ i ] ) : toLower( data[ i ] );
+    }
+  }
+
+  /*
+  * Upper cases the first letter and every letter following a space or a
+  * quote, and lower cases all others.
+  */
+  void mapTitleCase( char * const data, std::size_t const size,
+    bool const plainAscii )
+  {
+    if( size == 0 )
+    {
+      return;
+    }
+
+    data[ 0 ] = toUpper( data[ 0 ] );
+
+    std::size_t i = 1;
+
+#ifdef SYNTAX_HANDLER_SSE2
+    // Case mapping keeps spaces and quotes, so data[ i - 1 ] may be read
+    // after it has been mapped.
+    for( ; plainAscii && i + 16 <= size; i += 16 )
+    {
+      __m128i chunk =
+        _mm_loadu_si128( reinterpret_cast< __m128i const * >( data + i ) );
+      __m128i const previous =
+        _mm_loadu_si128( reinterpret_cast< __m128i const * >( data + i - 1 ) );
+
+      if( _mm_movemask_epi8( chunk ) != 0 )
+      {
+        for( std::size_t j = i; j < i + 16; j++ )
+        {
+          data[ j ] = isWordStart( data[ j - 1 ] ) ? toUpper( data[ j ] ) :
+                                                     toLower( data[ j ] );
+        }
+
+        continue;
+      }
+
+      __m128i const wordStart =
+        _mm_or_si128( _mm_cmpeq_epi8( previous, _mm_set1_epi8( ' ' ) ),
+          _mm_cmpeq_epi8( previous, _mm_set1_epi8( '\"' ) ) );
+      __m128i const flip = _mm_or_si128(
+        _mm_and_si128( wordStart, asciiRange( chunk, 'a', 'z' ) ),
+        _mm_andnot_si128( wordStart, asciiRange( chunk, 'A', 'Z' ) ) );
+
+      chunk =
+        _mm_xor_si128( chunk, _mm_and_si128( flip, _mm_set1_epi8( 0x20 ) ) );
+      _mm_storeu_si128( reinterpret_cast< __m128i * >( data + i ), chunk );
+    }
+#endif
+
+    for( ; i < size; i++ )
+    {
+      data[ i ] = isWordStart( data[ i - 1 ] ) ? toUpper( data[ i ] ) :
+                                                 toLower( data[ i ] );
+    }
+  }
+
+  /*
+  * Title cases the record running from start to the end of str, see
+  * SyntaxHandler::makeTitleCase.
+  */
+  void titleCaseRecord( std::string & str, std::size_t const start,
+    bool const plainAscii )
+  {
+    std::size_t const terminator = str.find( '\0', start );
+
+    if( terminator != std::string::npos )
+    {
+      str.resize( terminator );
+    }
+
+    if( start < str.size() && str[ start ] == ' ' )
+    {
+      str.erase( start, 1 );
+    }
+
+    mapTitleCase( &str[ 0 ] + start, str.size() - start, plainAscii );
+
+    if( str.compare( start, 4, "The " ) == 0 )
+    {
+      std::rotate( str.begin() + start, str.begin() + start + 4, str.end() );
+      str.insert( str.size() - 4, ", " );
+    }
+  }
+
+  /*
+  * Copies source to destination, dropping one leading space and collapsing
+  * each run of whitespace to its first character. destination may overlap
+  * source as long as it does not start after it. Returns the length of the
+  * result.
+  */
+  std::size_t trimRecord( char const * const source, std::size_t const size,
+    char * const destination )
+  {
+    std::size_t read = ( size > 0 && source[ 0 ] == ' ' ) ? 1 : 0;
+    std::size_t written = 0;
+    bool lastWasSpace = false;
+
+    while( read < size )
+    {
+#ifdef SYNTAX_HANDLER_SSE2
+      if( read + 16 <= size )
+      {
+        __m128i const chunk = _mm_loadu_si128(
+          reinterpret_cast< __m128i const * >( source + read ) );
+
+        if( _mm_movemask_epi8( _mm_or_si128( chunk, asciiSpace( chunk ) ) )
+          == 0 )
+        {
+          _mm_storeu_si128(
+            reinterpret_cast< __m128i * >( destination + written ), chunk );
+          read += 16;
+          written += 16;
+          lastWasSpace = false;
+
+          continue;
+        }
+      }
+
+      std::size_t const end = std::min( read + 16, size );
+#else
+      std::size_t const end = size;
+#endif
+
+      for( ; read < end; read++ )
+      {
+        bool const space = isSpace( source[ read ] );
+
+        if( space && lastWasSpace )
+        {
+          continue;
+        }
+
+        destination[ written++ ] = source[ read ];
+        lastWasSpace = space;
+      }
+    }
+
+    return written;
+  }
+
+  /*
+  * Calls onToken with each token of str between separators, skipping tokens
+  * made up of nothing but spaces.
+  */
+  template< typename TokenCallback >
+  void forEachToken( std::string_view const str, char const separator,
+    TokenCallback const & onToken )
+  {
+    std::size_t start = 0;
+
+    while( start <= str.size() )
+    {
+      std::size_t end = str.find( separator, start );
+
+      if( end == std::string_view::npos )
+      {
+        end = str.size();
+      }
+
+      std::string_view const token = str.substr( start, end - start );
+
+      if( token.find_first_not_of( ' ' ) != std::string_view::npos )
+      {
+        onToken( token );
+      }
+
+      start = end + 1;
+    }
+  }
+
+  /*
+  * Calls onToken with each stretch of str outside quotes, and each quoted
+  * stretch including its quotes, skipping stretches made up of nothing but
+  * spaces. The text after an unmatched quote is passed without the quote.
+  */
+  template< typename TokenCallback >
+  void forEachQuotedToken( std::string_view const str,
+    TokenCallback const & onToken )
+  {
+    std::size_t start = 0;
+    std::size_t quote = 0;
+
+    while( ( quote = str.find( '\"', start ) ) != std::string_view::npos )
+    {
+      std::string_view const unquoted = str.substr( start, quote - start );
+
+      if( unquoted.find_first_not_of( ' ' ) != std::string_view::npos )
+      {
+        onToken( unquoted );
+      }
+
+      std::size_t const closing = str.find( '\"', quote + 1 );
+
+      if( closing == std::string_view::npos )
+      {
+        start = quote + 1;
+
+        break;
+      }
+
+      std::string_view const quoted = str.substr( quote, closing - quote + 1 );
+
+      if( quoted.find_first_not_of( ' ', 1 ) != quoted.size() - 1 )
+      {
+        onToken( quoted );
+      }
+
+      start = closing + 1;
+    }
+
+    std::string_view const rest = str.substr( start );
+
+    if( rest.find_first_not_of( ' ' ) != std::string_view::npos )
+    {
+      onToken( rest );
+    }
+  }
+}
+
 SyntaxHandler::SyntaxHandler()
 {
 }
@@ -16,96 +326,161 @@ SyntaxHandler::~SyntaxHandler()
 
 void SyntaxHandler::makeUpperCase( std::string & in ) const
 {
-  std::transform( in.begin(),
-    in.end(),
-    in.begin(),
-    std::function< int( int ) >( ::toupper ) );
+  mapCase( &in[ 0 ], in.size(), true, plainAsciiCase() );
 }
 
 void SyntaxHandler::makeLowerCase( std::string & in ) const
 {
-  std::transform( in.begin(),
-    in.end(),
-    in.begin(),
-    std::function< int( int ) >( ::tolower ) );
+  mapCase( &in[ 0 ], in.size(), false, plainAsciiCase() );
 }
 
 void SyntaxHandler::makeTitleCase( std::string & in ) const
 {
-  char * charArrayOfIn = ( char * ) in.c_str();
-  size_t arrLen = strlen( charArrayOfIn );
+  titleCaseRecord( in, 0, plainAsciiCase() );
+}
+
+void SyntaxHandler::trimWhiteSpace( std::string & in ) const
+{
+  in.resize( trimRecord( in.data(), in.size(), &in[ 0 ] ) );
+}
+
+void SyntaxHandler::makeUpperCase( std::vector< std::string > & records ) const
+{
+  bool const plainAscii = plainAsciiCase();
 
-  if( charArrayOfIn[ 0 ] == ' ' )
+  for( auto & it : records )
   {
-    memmove( charArrayOfIn, charArrayOfIn + 1, arrLen );
-    arrLen--;
+    mapCase( &it[ 0 ], it.size(), true, plainAscii );
   }
+}
 
-  charArrayOfIn[ 0 ] = toupper( charArrayOfIn[ 0 ] );
+void SyntaxHandler::makeLowerCase( std::vector< std::string > & records ) const
+{
+  bool const plainAscii = plainAsciiCase();
 
-  for( size_t i = 1; i <= arrLen; i++ )
+  for( auto & it : records )
   {
-    if( charArrayOfIn[ i - 1 ] == ' ' || charArrayOfIn[ i - 1 ] == '\"' )
-    {
-      charArrayOfIn[ i ] = toupper( charArrayOfIn[ i ] );
+    mapCase( &it[ 0 ], it.size(), false, plainAscii );
+  }
+}
 
-      continue;
-    }
-    charArrayOfIn[ i ] = tolower( charArrayOfIn[ i ] );
+void SyntaxHandler::makeTitleCase( std::vector< std::string > & records ) const
+{
+  bool const plainAscii = plainAsciiCase();
+
+  for( auto & it : records )
+  {
+    titleCaseRecord( it, 0, plainAscii );
+  }
+}
+
+void SyntaxHandler::trimWhiteSpace( std::vector< std::string > & records ) const
+{
+  for( auto & it : records )
+  {
+    trimWhiteSpace( it );
   }
+}
+
+void SyntaxHandler::makeTitleCase(
+  std::string & arena, char const & recordDelim ) const
+{
+  bool const plainAscii = plainAsciiCase();
+  std::string titled;
+  std::size_t start = 0;
 
-  in = std::string( charArrayOfIn );
+  titled.reserve( arena.size() + arena.size() / 8 );
 
-  if( in.substr( 0, 4 ).compare( "The " ) == 0 )
+  while( start <= arena.size() )
   {
-    in = in.substr( 4 ) + ", The ";
+    std::size_t end = arena.find( recordDelim, start );
+
+    if( end == std::string::npos )
+    {
+      end = arena.size();
+    }
+
+    std::size_t const recordStart = titled.size();
+
+    titled.append( arena, start, end - start );
+    titleCaseRecord( titled, recordStart, plainAscii );
+
+    if( end < arena.size() )
+    {
+      titled += recordDelim;
+    }
+
+    start = end + 1;
   }
+
+  arena.swap( titled );
 }
 
-void SyntaxHandler::trimWhiteSpace( std::string & in ) const
+void SyntaxHandler::trimWhiteSpace(
+  std::string & arena, char const & recordDelim ) const
 {
-  std::string tmpStr;
+  std::size_t start = 0;
+  std::size_t written = 0;
 
-  if( in.at( 0 ) == ' ' )
+  while( start <= arena.size() )
   {
-    in = in.substr( 1 );
+    std::size_t end = arena.find( recordDelim, start );
+
+    if( end == std::string::npos )
+    {
+      end = arena.size();
+    }
+
+    written +=
+      trimRecord( arena.data() + start, end - start, &arena[ written ] );
+
+    if( end < arena.size() )
+    {
+      arena[ written++ ] = recordDelim;
+    }
+
+    start = end + 1;
   }
 
-  std::unique_copy( in.begin(),
-    in.end(),
-    std::back_insert_iterator< std::string >( tmpStr ),
-    []( char i, char j ) { return std::isspace( i ) && std::isspace( j ); } );
+  arena.resize( written );
+}
 
-  in = tmpStr;
+bool SyntaxHandler::startsWith(
+  std::string_view in, std::string_view prefix ) const
+{
+  return in.size() >= prefix.size()
+    && in.compare( 0, prefix.size(), prefix ) == 0;
 }
 
 bool SyntaxHandler::startsWith(
   std::string const & in, std::string const & prefix ) const
 {
-  return in.substr( 0, prefix.length() ) == prefix ? true : false;
+  return startsWith( std::string_view( in ), std::string_view( prefix ) );
 }
 
 bool SyntaxHandler::startsWith(
   char const * const & in, char const * const & prefix ) const
 {
-  return startsWith( std::string( in ), std::string( prefix ) );
+  return startsWith( std::string_view( in ), std::string_view( prefix ) );
 }
 
 bool SyntaxHandler::endsWith(
-  std::string const & in, std::string const & suffix ) const
+  std::string_view in, std::string_view suffix ) const
 {
-  if( in.length() < suffix.length() )
-  {
-    return false;
-  }
+  return in.size() >= suffix.size()
+    && in.compare( in.size() - suffix.size(), suffix.size(), suffix ) == 0;
+}
 
-  return in.substr( in.length() - suffix.length() ) == suffix ? true : false;
+bool SyntaxHandler::endsWith(
+  std::string const & in, std::string const & suffix ) const
+{
+  return endsWith( std::string_view( in ), std::string_view( suffix ) );
 }
 
 bool SyntaxHandler::endsWith(
   char const * const & in, char const * const & suffix ) const
 {
-  return endsWith( std::string( in ), std::string( suffix ) );
+  return endsWith( std::string_view( in ), std::string_view( suffix ) );
 }
 
 std::string SyntaxHandler::centerString(
@@ -120,72 +495,58 @@ std::string SyntaxHandler::centerString(
     whiteSpace--;
   }
 
-  return whiteSpace > 0 ? ( std::string( whiteSpace / 2, ' ' ) + str
-           + std::string( whiteSpace / 2, ' ' ) ) :
-                          str;
+  if( whiteSpace <= 0 )
+  {
+    return str;
+  }
+
+  std::string centered( str.size() + whiteSpace, ' ' );
+
+  centered.replace( whiteSpace / 2, str.size(), str );
+
+  return centered;
 }
 
 std::vector< std::string > SyntaxHandler::splitString(
-  std::string str, char const & charToSplitOn ) const
+  std::string const & str, char const & charToSplitOn ) const
 {
-  size_t i = 0;
   std::vector< std::string > ret;
 
-  while( ( i = str.find( charToSplitOn ) ) != std::string::npos )
-  {
-    std::string const subString = str.substr( 0, i );
-
-    if( subString.find_first_not_of( ' ' ) != std::string::npos )
-    {
-      ret.push_back( subString );
-    }
-
-    str.erase( 0, i + 1 );
-  }
-  if( str.find_first_not_of( ' ' ) != std::string::npos )
-  {
-    ret.push_back( str );
-  }
+  forEachToken( str, charToSplitOn,
+    [ &ret ]( std::string_view const token ) { ret.emplace_back( token ); } );
 
   return ret;
 }
 
 std::vector< std::string > SyntaxHandler::splitStringsInQuotes(
-  std::string str ) const
+  std::string const & str ) const
 {
-  size_t i = 0;
   std::vector< std::string > ret;
-  bool secondQuote = false;
 
-  while( ( i = str.find( "\"" ) ) != std::string::npos )
-  {
-    if( secondQuote )
-    {
-      std::string const subString = str.substr( 0, i );
-      if( subString.find_first_not_of( ' ' ) != std::string::npos )
-      {
-        ret.push_back( "\"" + subString + "\"" );
-      }
-      str.erase( 0, i + 1 );
-      secondQuote = false;
+  forEachQuotedToken( str,
+    [ &ret ]( std::string_view const token ) { ret.emplace_back( token ); } );
 
-      continue;
-    }
+  return ret;
+}
 
-    std::string const subString = str.substr( 0, i );
+std::vector< std::string_view > SyntaxHandler::splitStringView(
+  std::string_view str, char const & charToSplitOn ) const
+{
+  std::vector< std::string_view > ret;
 
-    if( subString.find_first_not_of( ' ' ) != std::string::npos )
-    {
-      ret.push_back( subString );
-    }
+  forEachToken( str, charToSplitOn,
+    [ &ret ]( std::string_view const token ) { ret.push_back( token ); } );
 
-    str.erase( 0, i + strlen( "\"" ) );
-    secondQuote = true;
-  }
-  if( str.find_first_not_of( ' ' ) != std::string::npos )
-  {
-    ret.push_back( str );
-  }
+  return ret;
+}
+
+std::vector< std::string_view > SyntaxHandler::splitStringsInQuotesView(
+  std::string_view str ) const
+{
+  std::vector< std::string_view > ret;
+
+  forEachQuotedToken( str,
+    [ &ret ]( std::string_view const token ) { ret.push_back( token ); } );
 
   return ret;
 }